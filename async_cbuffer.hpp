@@ -0,0 +1,526 @@
+#ifndef ASYNC_CBUFFER_H
+#define ASYNC_CBUFFER_H
+
+#include "cbuffer.hpp"
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <vector>
+
+/**
+@file async_cbuffer.hpp
+@brief Dichiarazione della classe async_cbuffer, canale limitato tra coroutine, e del suo esecutore
+**/
+
+class cbuffer_executor;
+
+/**
+@brief Coroutine di primo livello eseguita da cbuffer_executor
+
+Parte sospesa e viene avviata da cbuffer_executor::spawn, che ne prende possesso
+**/
+class cbuffer_task {
+    public:
+        struct promise_type {
+            cbuffer_executor *executor; ///< Esecutore proprietario, impostato da spawn
+            std::size_t id; ///< Identificativo restituito da spawn
+            std::exception_ptr exception; ///< Eccezione uscita dal corpo della coroutine
+
+            promise_type(): executor(0), id(0), exception() {}
+
+            cbuffer_task get_return_object(){
+                return cbuffer_task(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            std::suspend_always initial_suspend() noexcept { return std::suspend_always(); }
+
+            /// Segnala all'esecutore la terminazione, il frame viene distrutto da lui
+            struct final_awaiter {
+                bool await_ready() noexcept { return false; }
+                void await_suspend(std::coroutine_handle<promise_type> h) noexcept;
+                void await_resume() noexcept {}
+            };
+
+            final_awaiter final_suspend() noexcept { return final_awaiter(); }
+
+            void return_void() {}
+
+            void unhandled_exception(){
+                exception = std::current_exception();
+            }
+        };
+
+        typedef std::coroutine_handle<promise_type> handle_type;
+
+        cbuffer_task(cbuffer_task &&other) noexcept: _handle(other._handle) {
+            other._handle = handle_type();
+        }
+
+        ~cbuffer_task(){
+            if(_handle)
+                _handle.destroy();
+        }
+
+    private:
+        friend class cbuffer_executor;
+
+        handle_type _handle; ///< Frame non ancora consegnato a un esecutore
+
+        explicit cbuffer_task(handle_type h): _handle(h) {}
+
+        cbuffer_task(const cbuffer_task &other) = delete;
+        cbuffer_task &operator=(const cbuffer_task &other) = delete;
+};
+
+/**
+@brief Esecutore single-thread di cbuffer_task
+
+Mantiene una coda FIFO di coroutine pronte e le riprende una alla volta nel thread
+che chiama run. Le coroutine possono essere annullate con cancel mentre sono sospese:
+il frame viene distrutto e gli awaiter di async_cbuffer si staccano dal canale
+**/
+class cbuffer_executor {
+    public:
+        /**
+        @brief Avvia una coroutine
+
+        La coroutine viene messa in coda e parte alla prossima run
+        @return identificativo da usare con done e cancel
+        **/
+        std::size_t spawn(cbuffer_task task){
+            cbuffer_task::handle_type h = task._handle;
+            task._handle = cbuffer_task::handle_type();
+            h.promise().executor = this;
+            h.promise().id = _tasks.size();
+            _tasks.push_back(h);
+            post(h);
+            return h.promise().id;
+        }
+
+        /**
+        @brief Accoda una coroutine sospesa da riprendere
+        **/
+        void post(std::coroutine_handle<> h){
+            _ready.push_back(h);
+        }
+
+        /**
+        @brief Riprende le coroutine pronte finché la coda non è vuota
+
+        Se una coroutine termina con un'eccezione, questa viene rilanciata
+        @return numero di coroutine riprese
+        **/
+        std::size_t run(){
+            std::size_t resumed = 0;
+            while(!_ready.empty()){
+                std::coroutine_handle<> h = _ready.front();
+                _ready.pop_front();
+                h.resume();
+                ++resumed;
+                reap();
+            }
+            return resumed;
+        }
+
+        /**
+        @brief Controllo se la coroutine id è terminata o è stata annullata
+        **/
+        bool done(std::size_t id) const {
+            return !_tasks.at(id);
+        }
+
+        /**
+        @brief Annullamento di una coroutine sospesa
+
+        Il frame viene distrutto; un valore già consegnato alla coroutine da un canale va perso
+        @return false se la coroutine era già terminata
+        **/
+        bool cancel(std::size_t id){
+            cbuffer_task::handle_type h = _tasks.at(id);
+            if(!h)
+                return false;
+            _ready.erase(std::remove(_ready.begin(), _ready.end(), std::coroutine_handle<>(h)), _ready.end());
+            _tasks[id] = cbuffer_task::handle_type();
+            h.destroy();
+            return true;
+        }
+
+        /**
+        @brief Numero di coroutine né terminate né annullate
+        **/
+        std::size_t pending() const {
+            return _tasks.size() - std::count(_tasks.begin(), _tasks.end(), cbuffer_task::handle_type());
+        }
+
+        cbuffer_executor(): _ready(), _tasks(), _finished() {}
+
+        ~cbuffer_executor(){
+            for(std::size_t i = 0; i < _tasks.size(); ++i)
+                if(_tasks[i])
+                    _tasks[i].destroy();
+        }
+
+    private:
+        friend struct cbuffer_task::promise_type::final_awaiter;
+
+        std::deque<std::coroutine_handle<> > _ready; ///< Coroutine pronte
+        std::vector<cbuffer_task::handle_type> _tasks; ///< Frame posseduti, nullo se terminato
+        std::vector<std::size_t> _finished; ///< Terminate dall'ultima reap
+
+        cbuffer_executor(const cbuffer_executor &other) = delete;
+        cbuffer_executor &operator=(const cbuffer_executor &other) = delete;
+
+        /// Distrugge i frame terminati, rilanciando la prima eccezione trovata
+        void reap(){
+            std::exception_ptr error;
+            for(std::size_t i = 0; i < _finished.size(); ++i){
+                cbuffer_task::handle_type h = _tasks[_finished[i]];
+                if(!error)
+                    error = h.promise().exception;
+                _tasks[_finished[i]] = cbuffer_task::handle_type();
+                h.destroy();
+            }
+            _finished.clear();
+            if(error)
+                std::rethrow_exception(error);
+        }
+};
+
+inline void cbuffer_task::promise_type::final_awaiter::await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+    h.promise().executor->_finished.push_back(h.promise().id);
+}
+
+/**
+@brief Canale limitato tra coroutine basato su cbuffer
+
+co_await push(x) sospende il produttore se il buffer è pieno, co_await pop() sospende il
+consumatore se è vuoto. Nelle transizioni la coroutine in attesa viene ripresa subito, nello
+stesso thread, con un trasferimento simmetrico, mentre quella che l'ha svegliata viene
+rimessa in coda all'esecutore: un valore spinto verso un consumatore in attesa gli viene
+consegnato direttamente senza passare dal buffer. Le attese sono servite in ordine FIFO.
+Dopo close le push restituiscono false e le pop, esauriti gli elementi, un optional vuoto.
+Un canale non è thread-safe: tutte le coroutine che lo usano girano sullo stesso esecutore
+**/
+template <typename T>
+class async_cbuffer {
+    public:
+        typedef T value_type; ///< Definzione del tipo corrispondente al valore contenuto del buffer
+        typedef typename cbuffer<T>::size_type size_type; ///< Definzione del tipo corrispondente alla dimensione
+
+    private:
+        /// Coroutine sospesa, nodo di una lista intrusiva nel frame della coroutine
+        struct waiter {
+            async_cbuffer *channel; ///< Canale in cui è accodato, nullo se non accodato
+            waiter *prev;
+            waiter *next;
+            std::coroutine_handle<> handle;
+            std::optional<T> value; ///< Valore da inserire (push) o ricevuto (pop)
+            bool pusher; ///< true se accodato in _pushers
+
+            waiter(): channel(0), prev(0), next(0), handle(), value(), pusher(false) {}
+
+            /// Eseguito anche quando il frame viene distrutto da cbuffer_executor::cancel
+            ~waiter(){
+                if(channel)
+                    channel->unlink(this);
+            }
+        };
+
+        /// Lista FIFO di waiter
+        struct waiter_list {
+            waiter *head;
+            waiter *tail;
+
+            waiter_list(): head(0), tail(0) {}
+        };
+
+        cbuffer<T> _elements; ///< Elementi
+        cbuffer_executor &_executor;
+        waiter_list _pushers; ///< Produttori in attesa di spazio
+        waiter_list _poppers; ///< Consumatori in attesa di elementi
+        bool _closed;
+
+        async_cbuffer(const async_cbuffer &other) = delete;
+        async_cbuffer &operator=(const async_cbuffer &other) = delete;
+
+        /// Accoda la coroutine h in attesa su w
+        void append(waiter *w, std::coroutine_handle<> h, bool pusher){
+            waiter_list &l = pusher ? _pushers : _poppers;
+            w->channel = this;
+            w->handle = h;
+            w->pusher = pusher;
+            w->prev = l.tail;
+            w->next = 0;
+            if(l.tail)
+                l.tail->next = w;
+            else
+                l.head = w;
+            l.tail = w;
+        }
+
+        static void remove(waiter_list &l, waiter *w){
+            if(w->prev)
+                w->prev->next = w->next;
+            else
+                l.head = w->next;
+            if(w->next)
+                w->next->prev = w->prev;
+            else
+                l.tail = w->prev;
+            w->prev = w->next = 0;
+        }
+
+        /// Toglie dalla lista il primo waiter, che il chiamante deve riprendere
+        static waiter *take(waiter_list &l){
+            waiter *w = l.head;
+            remove(l, w);
+            w->channel = 0;
+            return w;
+        }
+
+        void unlink(waiter *w){
+            remove(w->pusher ? _pushers : _poppers, w);
+            w->channel = 0;
+        }
+
+        /**
+        @brief Esegue la push se può farlo senza attendere
+
+        @param woken impostato alla coroutine da riprendere, se la push ne ha sbloccata una
+        @return false se bisogna attendere
+        **/
+        template <typename V>
+        bool push_now(V &&value, bool &ok, std::coroutine_handle<> &woken){
+            if(_closed){
+                ok = false;
+                return true;
+            }
+            if(_poppers.head){
+                waiter *w = take(_poppers);
+                w->value.emplace(std::forward<V>(value));
+                woken = w->handle;
+                ok = true;
+                return true;
+            }
+            if(_elements.full() || _elements.size() == 0)
+                return false;
+            _elements.insert(std::forward<V>(value));
+            ok = true;
+            return true;
+        }
+
+        /// Come push_now per l'estrazione
+        bool pop_now(std::optional<T> &out, std::coroutine_handle<> &woken){
+            if(!_elements.empty()){
+                out.emplace(_elements.pop());
+                if(_pushers.head){
+                    waiter *w = take(_pushers);
+                    _elements.insert(std::move(*w->value));
+                    w->value.reset();
+                    woken = w->handle;
+                }
+                return true;
+            }
+            if(_pushers.head){
+                // capacità 0: consegna diretta dal produttore in attesa
+                waiter *w = take(_pushers);
+                out.emplace(std::move(*w->value));
+                w->value.reset();
+                woken = w->handle;
+                return true;
+            }
+            return _closed;
+        }
+
+    public:
+        /// Awaiter di push, co_await restituisce false se il canale è chiuso
+        class push_awaiter {
+            public:
+                bool await_ready(){
+                    _queued = !_channel->push_now(std::move(*_waiter.value), _ok, _woken);
+                    return !_queued && !_woken;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> h){
+                    if(_woken){
+                        _channel->_executor.post(h);
+                        return _woken;
+                    }
+                    _channel->append(&_waiter, h, true);
+                    return std::noop_coroutine();
+                }
+
+                bool await_resume(){
+                    // svegliato da pop il valore è stato preso, da close è ancora qui
+                    return _queued ? !_waiter.value.has_value() : _ok;
+                }
+
+            private:
+                friend class async_cbuffer;
+
+                async_cbuffer *_channel;
+                waiter _waiter;
+                bool _ok;
+                bool _queued; ///< true se la coroutine ha atteso in _pushers
+                std::coroutine_handle<> _woken;
+
+                template <typename V>
+                push_awaiter(async_cbuffer *c, V &&value): _channel(c), _waiter(), _ok(false), _queued(false), _woken() {
+                    _waiter.value.emplace(std::forward<V>(value));
+                }
+        };
+
+        /// Awaiter di pop, co_await restituisce un optional vuoto se il canale è chiuso e vuoto
+        class pop_awaiter {
+            public:
+                bool await_ready(){
+                    _queued = !_channel->pop_now(_waiter.value, _woken);
+                    return !_queued && !_woken;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> h){
+                    if(_woken){
+                        _channel->_executor.post(h);
+                        return _woken;
+                    }
+                    _channel->append(&_waiter, h, false);
+                    return std::noop_coroutine();
+                }
+
+                std::optional<T> await_resume(){
+                    return std::move(_waiter.value);
+                }
+
+            private:
+                friend class async_cbuffer;
+
+                async_cbuffer *_channel;
+                waiter _waiter; ///< value riceve l'elemento anche quando non si attende
+                bool _queued;
+                std::coroutine_handle<> _woken;
+
+                explicit pop_awaiter(async_cbuffer *c): _channel(c), _waiter(), _queued(false), _woken() {}
+        };
+
+        /**
+        @brief Costruttore con capacità
+
+        @param executor Esecutore su cui girano le coroutine che usano il canale
+        @param size Capacità del buffer; con 0 ogni valore passa direttamente da produttore a consumatore
+        **/
+        async_cbuffer(cbuffer_executor &executor, size_type size): _elements(size), _executor(executor),
+            _pushers(), _poppers(), _closed(false) {}
+
+        /**
+        @brief Distruttore
+
+        Le coroutine ancora in attesa restano sospese e vengono staccate dal canale
+        **/
+        ~async_cbuffer(){
+            while(_pushers.head)
+                take(_pushers);
+            while(_poppers.head)
+                take(_poppers);
+        }
+
+        /**
+        @brief Inserimento, da usare con co_await
+
+        Sospende la coroutine finché c'è spazio; co_await restituisce false se il canale è chiuso
+        **/
+        push_awaiter push(const T &value){
+            return push_awaiter(this, value);
+        }
+
+        push_awaiter push(T &&value){
+            return push_awaiter(this, std::move(value));
+        }
+
+        /**
+        @brief Estrazione, da usare con co_await
+
+        Sospende la coroutine finché c'è un elemento; co_await restituisce std::optional<T>,
+        vuoto se il canale è chiuso ed esaurito
+        **/
+        pop_awaiter pop(){
+            return pop_awaiter(this);
+        }
+
+        /**
+        @brief Inserimento senza attesa, utilizzabile anche fuori da una coroutine
+
+        Un consumatore svegliato viene messo in coda all'esecutore
+        @return false se il buffer è pieno o il canale è chiuso
+        **/
+        bool try_push(const T &value){
+            bool ok = false;
+            std::coroutine_handle<> woken;
+            if(!push_now(value, ok, woken))
+                return false;
+            if(woken)
+                _executor.post(woken);
+            return ok;
+        }
+
+        /**
+        @brief Estrazione senza attesa, utilizzabile anche fuori da una coroutine
+
+        @return optional vuoto se non ci sono elementi
+        **/
+        std::optional<T> try_pop(){
+            std::optional<T> out;
+            std::coroutine_handle<> woken;
+            pop_now(out, woken);
+            if(woken)
+                _executor.post(woken);
+            return out;
+        }
+
+        /**
+        @brief Chiusura del canale
+
+        Tutte le coroutine in attesa vengono messe in coda all'esecutore: i produttori
+        ricevono false, i consumatori un optional vuoto. Gli elementi nel buffer restano estraibili
+        **/
+        void close(){
+            _closed = true;
+            while(_pushers.head)
+                _executor.post(take(_pushers)->handle);
+            while(_poppers.head)
+                _executor.post(take(_poppers)->handle);
+        }
+
+        bool closed() const {
+            return _closed;
+        }
+
+        /**
+        @brief Numero di coroutine in attesa sul canale
+        **/
+        size_type waiting() const {
+            size_type n = 0;
+            for(waiter *w = _pushers.head; w; w = w->next)
+                ++n;
+            for(waiter *w = _poppers.head; w; w = w->next)
+                ++n;
+            return n;
+        }
+
+        bool empty() const {
+            return _elements.empty();
+        }
+
+        bool full() const {
+            return _elements.full();
+        }
+
+        /**
+        @brief Capacità del buffer
+        **/
+        size_type size() const {
+            return _elements.size();
+        }
+};
+
+#endif
@@ -0,0 +1,1101 @@
+#include "cbuffer.hpp"
+#include "mirrored_cbuffer.hpp"
+#include "cbuffer_algo.hpp"
+#include "windowed_cbuffer.hpp"
+#include "voce.h"
+#include "soa_cbuffer.hpp"
+#include "compact_voce.hpp"
+#include "indexed_cbuffer.hpp"
+#include "blocking_cbuffer.hpp"
+#include "persistent_cbuffer.hpp"
+#include "cbuffer_stats.hpp"
+#include "cbuffer_bench.hpp"
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <regex>
+#include <execution>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+/**
+@file bench.cpp
+@brief Benchmark di throughput dei buffer circolari
+**/
+
+typedef std::chrono::steady_clock bench_clock;
+
+/**
+@brief Numero di allocazioni dinamiche, per gli allocs/op dei microbenchmark
+**/
+static std::atomic<std::size_t> allocations(0);
+
+/**
+@brief Allocazione e rilascio usati da tutte le versioni sostituite di operator new e delete
+
+Non inline: se il compilatore vedesse la coppia operator new / free segnalerebbe
+-Wmismatched-new-delete sulle delete del programma
+**/
+[[gnu::noinline]] static void *counted_allocate(std::size_t n, std::size_t align){
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = align > alignof(std::max_align_t) ?
+        std::aligned_alloc(align, (n + align - 1) / align * align) : std::malloc(n ? n : 1);
+    if(!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+[[gnu::noinline]] static void counted_release(void *p) noexcept { std::free(p); }
+
+void *operator new(std::size_t n){ return counted_allocate(n, 0); }
+void *operator new(std::size_t n, std::align_val_t al){ return counted_allocate(n, static_cast<std::size_t>(al)); }
+
+void operator delete(void *p) noexcept { counted_release(p); }
+void operator delete(void *p, std::size_t) noexcept { counted_release(p); }
+void operator delete(void *p, std::align_val_t) noexcept { counted_release(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { counted_release(p); }
+
+std::size_t bench_allocation_count(){
+    return allocations.load(std::memory_order_relaxed);
+}
+
+/**
+@brief Durata in secondi tra due istanti
+**/
+double seconds(bench_clock::time_point start, bench_clock::time_point stop){
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+/**
+@brief Stampa il risultato di un benchmark
+
+@param name Nome del benchmark
+@param items Numero di elementi trasferiti
+@param secs Durata in secondi
+**/
+void report(const char *name, long long items, double secs){
+    std::cout << name << ": " << items << " items in " << secs << " s, "
+              << (items / secs) / 1e6 << " Mitems/s" << std::endl;
+}
+
+/**
+@brief Throughput di spsc_cbuffer<int>
+
+Un thread produttore e uno consumatore si scambiano items interi
+**/
+void bench_spsc(long long items, std::size_t size){
+    spsc_cbuffer<int> cb(size);
+    bench_clock::time_point start = bench_clock::now();
+    std::thread producer([&cb, items](){
+        for(long long i = 0; i < items; )
+            if(cb.try_push((int)i))
+                ++i;
+            else
+                std::this_thread::yield();
+    });
+    long long sum = 0;
+    int value;
+    for(long long i = 0; i < items; )
+        if(cb.try_pop(value)){
+            sum += value;
+            ++i;
+        }else
+            std::this_thread::yield();
+    producer.join();
+    report("spsc_cbuffer<int> try_push/try_pop", items, seconds(start, bench_clock::now()));
+}
+
+/**
+@brief Throughput di spsc_cbuffer<int> con le operazioni bulk
+
+Il produttore e il consumatore trasferiscono blocchi di al più batch elementi
+**/
+void bench_spsc_bulk(long long items, std::size_t size, std::size_t batch){
+    spsc_cbuffer<int> cb(size);
+    bench_clock::time_point start = bench_clock::now();
+    std::thread producer([&cb, items, batch](){
+        std::vector<int> data(batch);
+        for(long long i = 0; i < items; ){
+            std::size_t n = std::min<long long>(batch, items - i);
+            for(std::size_t k = 0; k < n; ++k)
+                data[k] = (int)(i + k);
+            std::size_t pushed = 0;
+            while(pushed < n){
+                std::size_t k = cb.try_push_bulk(data.begin() + pushed, n - pushed);
+                if(k == 0)
+                    std::this_thread::yield();
+                pushed += k;
+            }
+            i += n;
+        }
+    });
+    std::vector<int> out(batch);
+    long long sum = 0;
+    for(long long i = 0; i < items; ){
+        std::size_t got = cb.try_pop_bulk(out.begin(), batch);
+        if(got == 0)
+            std::this_thread::yield();
+        for(std::size_t k = 0; k < got; ++k)
+            sum += out[k];
+        i += got;
+    }
+    producer.join();
+    report("spsc_cbuffer<int> bulk", items, seconds(start, bench_clock::now()));
+}
+
+/**
+@brief Throughput di un cbuffer<int> protetto da mutex
+
+Riferimento per spsc_cbuffer: ogni insert, lettura di cb[0] e remove avviene sotto lock,
+il produttore inserisce solo se il buffer non è pieno per non sovrascrivere dati
+**/
+void bench_mutex_cbuffer(long long items, int size){
+    cbuffer<int> cb(size);
+    std::mutex m;
+    bench_clock::time_point start = bench_clock::now();
+    std::thread producer([&cb, &m, items](){
+        for(long long i = 0; i < items; ){
+            std::lock_guard<std::mutex> lock(m);
+            if(!cb.full()){
+                cb.insert((int)i);
+                ++i;
+            }else
+                std::this_thread::yield();
+        }
+    });
+    long long sum = 0;
+    for(long long i = 0; i < items; ){
+        std::lock_guard<std::mutex> lock(m);
+        if(!cb.empty()){
+            sum += cb[0];
+            cb.remove();
+            ++i;
+        }else
+            std::this_thread::yield();
+    }
+    producer.join();
+    report("mutex + cbuffer<int> insert/remove", items, seconds(start, bench_clock::now()));
+}
+
+/**
+@brief Throughput di mpmc_cbuffer<int> con producers produttori e consumers consumatori
+
+Gli items vengono divisi tra i produttori, che usano push con overflow_spin,
+i consumatori estraggono finché il totale non è stato consumato
+**/
+void bench_mpmc(long long items, std::size_t size, unsigned producers, unsigned consumers){
+    mpmc_cbuffer<int> cb(size, overflow_spin);
+    std::atomic<long long> consumed(0);
+    std::vector<std::thread> threads;
+    bench_clock::time_point start = bench_clock::now();
+    for(unsigned p = 0; p < producers; ++p)
+        threads.push_back(std::thread([&cb, items, producers, p](){
+            long long first = items * p / producers, last = items * (p + 1) / producers;
+            for(long long i = first; i < last; ++i)
+                cb.push((int)i);
+        }));
+    for(unsigned c = 0; c < consumers; ++c)
+        threads.push_back(std::thread([&cb, &consumed, items](){
+            int value;
+            while(consumed.load(std::memory_order_relaxed) < items){
+                if(cb.try_pop(value))
+                    consumed.fetch_add(1, std::memory_order_relaxed);
+                else
+                    std::this_thread::yield();
+            }
+        }));
+    for(std::size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+    double secs = seconds(start, bench_clock::now());
+    std::ostringstream name;
+    name << "mpmc_cbuffer<int> " << producers << "P/" << consumers << "C";
+    report(name.str().c_str(), items, secs);
+}
+
+/**
+@brief Scalabilità di mpmc_cbuffer
+
+Fa variare produttori e consumatori da 1 al numero di thread hardware (per potenze di due
+più il massimo) per mostrare il comportamento sotto contesa
+**/
+void bench_mpmc_scaling(long long items, std::size_t size){
+    unsigned hw = std::thread::hardware_concurrency();
+    if(hw == 0)
+        hw = 1;
+    std::vector<unsigned> counts;
+    for(unsigned n = 1; n < hw; n <<= 1)
+        counts.push_back(n);
+    counts.push_back(hw);
+    for(std::size_t p = 0; p < counts.size(); ++p)
+        for(std::size_t c = 0; c < counts.size(); ++c)
+            bench_mpmc(items, size, counts[p], counts[c]);
+}
+
+/**
+@brief Generatore di dimensioni dei blocchi per i benchmark di streaming
+
+Congruenziale lineare, restituisce valori in [1, max]
+**/
+struct chunk_sizes {
+    unsigned long state;
+    std::size_t max;
+
+    explicit chunk_sizes(std::size_t m): state(12345), max(m) {}
+
+    std::size_t next(){
+        state = state * 6364136223846793005UL + 1442695040888963407UL;
+        return (state >> 33) % max + 1;
+    }
+};
+
+/**
+@brief Streaming di bytes attraverso un cbuffer<char>
+
+Il produttore scrive blocchi di dimensione variabile con reserve/commit (due tratti se
+lo spazio libero attraversa il wrap), il consumatore estrae blocchi di dimensione variabile
+con drain_into
+**/
+void bench_stream_cbuffer(long long bytes, int size, std::size_t max_chunk){
+    cbuffer<char> cb(size);
+    std::vector<char> src(max_chunk), dst(max_chunk);
+    for(std::size_t i = 0; i < src.size(); ++i)
+        src[i] = (char)i;
+    chunk_sizes in(max_chunk), out(max_chunk);
+    long long produced = 0, consumed = 0;
+    unsigned long check = 0;
+    bench_clock::time_point start = bench_clock::now();
+    while(consumed < bytes){
+        std::size_t want = std::min<long long>(in.next(), bytes - produced);
+        std::size_t done = 0;
+        for(int part = 0; part < 2 && done < want; ++part){
+            std::span<char> slots = cb.reserve((int)(want - done));
+            std::memcpy(slots.data(), src.data() + done, slots.size());
+            cb.commit((int)slots.size());
+            done += slots.size();
+        }
+        produced += done;
+        std::size_t got = cb.drain_into(dst.data(), (int)out.next());
+        if(got)
+            check += (unsigned char)dst[got - 1];
+        consumed += got;
+    }
+    double secs = seconds(start, bench_clock::now());
+    std::cout << "cbuffer<char> stream: " << bytes / secs / 1e9 << " GB/s (check " << check << ")" << std::endl;
+}
+
+/**
+@brief Riduzioni su una finestra di samples float
+
+Confronta un ciclo con operator[] e gli algoritmi di cbuffer_algo.hpp a ogni livello
+di istruzioni vettoriali; la finestra è piena e attraversa il wrap
+**/
+void bench_reductions(int samples, int rounds){
+    cbuffer<float> cb(samples);
+    for(int i = 0; i < samples + samples / 3; ++i)
+        cb.insert((float)(i % 1000) * 0.5f);
+    double check = 0;
+    bench_clock::time_point start = bench_clock::now();
+    for(int r = 0; r < rounds; ++r){
+        double s = 0;
+        std::size_t c = 0;
+        for(int i = 0; i < samples; ++i){
+            s += cb[i];
+            c += cb[i] > 250.0f;
+        }
+        check += s + c;
+    }
+    std::cout << "operator[] sum + count_if: " << (long long)samples * rounds / seconds(start, bench_clock::now()) / 1e6
+              << " Msamples/s (check " << check << ")" << std::endl;
+    const char *names[] = {"scalar", "vec128", "avx2"};
+    for(int isa = cbuffer_isa_scalar; isa <= cbuffer_isa_avx2; ++isa){
+        cbuffer_set_isa((cbuffer_isa)isa);
+        if(cbuffer_get_isa() != isa)
+            continue;
+        check = 0;
+        start = bench_clock::now();
+        for(int r = 0; r < rounds; ++r)
+            check += sum(cb) + count_if(cb, greater_than<float>{250.0f});
+        double secs = seconds(start, bench_clock::now());
+        std::cout << names[isa] << " sum + count_if: " << (long long)samples * rounds / secs / 1e6
+                  << " Msamples/s (check " << check << ")" << std::endl;
+    }
+}
+
+/**
+@brief Statistiche di una finestra scorrevole dopo ogni campione
+
+Confronta il ricalcolo completo con gli algoritmi di cbuffer_algo.hpp, O(capacità) per campione,
+con gli aggregatori incrementali di windowed_cbuffer, O(1) per campione
+**/
+void bench_windowed(long long samples, int capacity){
+    cbuffer<float> cb(capacity);
+    chunk_sizes gen(1000);
+    double check = 0;
+    bench_clock::time_point start = bench_clock::now();
+    for(long long i = 0; i < samples; ++i){
+        cb.insert((float)gen.next());
+        check += mean(cb) + min_value(cb) + max_value(cb) + variance(cb);
+    }
+    double full = seconds(start, bench_clock::now());
+
+    windowed_cbuffer<float, window_mean<float>, window_min<float>, window_max<float>, window_variance<float> > w(capacity);
+    gen = chunk_sizes(1000);
+    double wcheck = 0;
+    start = bench_clock::now();
+    for(long long i = 0; i < samples; ++i){
+        w.insert((float)gen.next());
+        wcheck += w.aggregator<window_mean<float> >().mean() + w.aggregator<window_min<float> >().min()
+                + w.aggregator<window_max<float> >().max() + w.aggregator<window_variance<float> >().variance();
+    }
+    double incremental = seconds(start, bench_clock::now());
+    std::cout << "window " << capacity << " mean/min/max/variance per sample: recompute "
+              << full / samples * 1e9 << " ns, windowed_cbuffer " << incremental / samples * 1e9
+              << " ns (check " << check << " / " << wcheck << ")" << std::endl;
+}
+
+/**
+@brief Filtro con regex su voce::ntel, sequenziale e con std::execution::par
+**/
+void bench_filter_regex(int size){
+    cbuffer<voce> rubrica(size);
+    for(int i = 0; i < size; ++i)
+        rubrica.insert(voce("Rossi", "Mario", (i % 3 ? "+39-" : "02-") + std::to_string(1000000 + i)));
+    std::regex mobile("\\+39-[0-9]+");
+    auto is_mobile = [&mobile](const voce &v){ return std::regex_match(v.ntel, mobile); };
+    bench_clock::time_point start = bench_clock::now();
+    std::size_t seq = filter(rubrica, is_mobile).size();
+    double seq_secs = seconds(start, bench_clock::now());
+    start = bench_clock::now();
+    std::size_t par = filter(std::execution::par, rubrica, is_mobile).size();
+    double par_secs = seconds(start, bench_clock::now());
+    std::cout << "regex filter on " << size << " voci: seq " << seq_secs * 1e3 << " ms, par " << par_secs * 1e3
+              << " ms on " << std::thread::hardware_concurrency() << " threads (matches " << seq << "/" << par << ")" << std::endl;
+}
+
+/**
+@brief Scansione dei prefissi di ntel su cbuffer<voce> e sulla colonna ntel di soa_cbuffer<voce>
+**/
+void bench_soa_scan(int size, int rounds){
+    cbuffer<voce> aos(size);
+    soa_cbuffer<voce> soa(size);
+    for(int i = 0; i < size + size / 3; ++i){
+        voce v("Cognome-" + std::to_string(i), "Nome-" + std::to_string(i),
+               (i % 3 ? "+39-" : "02-") + std::to_string(1000000 + i));
+        aos.insert(v);
+        soa.insert(std::move(v));
+    }
+    long long found = 0;
+    bench_clock::time_point start = bench_clock::now();
+    for(int r = 0; r < rounds; ++r){
+        std::span<const voce> one = aos.array_one(), two = aos.array_two();
+        for(std::size_t i = 0; i < one.size(); ++i)
+            found += one[i].ntel.compare(0, 4, "+39-") == 0;
+        for(std::size_t i = 0; i < two.size(); ++i)
+            found += two[i].ntel.compare(0, 4, "+39-") == 0;
+    }
+    double aos_secs = seconds(start, bench_clock::now());
+    long long soa_found = 0;
+    start = bench_clock::now();
+    for(int r = 0; r < rounds; ++r){
+        const soa_cbuffer<voce> &c = soa;
+        std::span<const std::string> one = c.array_one<voce_ntel>(), two = c.array_two<voce_ntel>();
+        for(std::size_t i = 0; i < one.size(); ++i)
+            soa_found += one[i].compare(0, 4, "+39-") == 0;
+        for(std::size_t i = 0; i < two.size(); ++i)
+            soa_found += two[i].compare(0, 4, "+39-") == 0;
+    }
+    double soa_secs = seconds(start, bench_clock::now());
+    std::cout << "ntel prefix scan on " << size << " voci: cbuffer<voce> " << aos_secs / rounds * 1e3
+              << " ms, soa_cbuffer<voce> " << soa_secs / rounds * 1e3 << " ms (found " << found << "/" << soa_found << ")" << std::endl;
+}
+
+/**
+@brief Inserimenti in una rubrica piena: cbuffer<voce>, cbuffer<compact_voce> e voce_ring
+
+I cognomi e i nomi si ripetono, i numeri sono tutti diversi e troppo lunghi per la small string optimization
+**/
+void bench_phone_book(long long items, int size){
+    const char *cognomi[] = {"Rossi", "Bianchi", "Verdi", "Esposito", "Romano", "Colombo"};
+    const char *nomi[] = {"Luca", "Paolo", "Giovanni", "Anna", "Sara"};
+    std::vector<voce> source;
+    for(int i = 0; i < 4096; ++i)
+        source.push_back(voce(cognomi[i % 6], nomi[i % 5], "+39-0333-555-" + std::to_string(1000000 + i)));
+
+    cbuffer<voce> plain(size);
+    bench_clock::time_point start = bench_clock::now();
+    for(long long i = 0; i < items; ++i)
+        plain.insert(source[i & 4095]);
+    report("cbuffer<voce> insert on full", items, seconds(start, bench_clock::now()));
+
+    voce_intern_table names;
+    cbuffer<compact_voce> compact(size);
+    start = bench_clock::now();
+    for(long long i = 0; i < items; ++i)
+        compact.insert(compact_voce(names, source[i & 4095]));
+    report("cbuffer<compact_voce> insert on full", items, seconds(start, bench_clock::now()));
+
+    voce_ring ring(size, (std::size_t)size * 32);
+    start = bench_clock::now();
+    for(long long i = 0; i < items; ++i)
+        ring.insert(source[i & 4095]);
+    report("voce_ring insert on full", items, seconds(start, bench_clock::now()));
+}
+
+/**
+@brief Ricerca per ntel: indexed_cbuffer contro scansione lineare di cbuffer<voce>
+
+Il buffer pieno ha size voci, le ricerche sono metà su numeri presenti e metà su numeri assenti
+**/
+void bench_indexed_lookup(int size){
+    cbuffer<voce> plain(size);
+    indexed_cbuffer<voce, voce_ntel_key> indexed(size);
+    for(int i = 0; i < size + size / 2; ++i){
+        voce v("Rossi", "Luca", "+39-0333-555-" + std::to_string(10000000 + i));
+        plain.insert(v);
+        indexed.insert(std::move(v));
+    }
+    chunk_sizes gen((std::size_t)size * 2);
+    int lookups = std::max(20, 20000000 / size);
+    std::vector<std::string> probes;
+    for(int i = 0; i < lookups; ++i)
+        probes.push_back("+39-0333-555-" + std::to_string(10000000 + size / 2 + gen.next() - 1));
+
+    long long found = 0;
+    bench_clock::time_point start = bench_clock::now();
+    for(int i = 0; i < lookups; ++i){
+        for(cbuffer<voce>::const_iterator it = plain.begin(); it != plain.end(); ++it)
+            if(it->ntel == probes[i]){
+                ++found;
+                break;
+            }
+    }
+    double linear = seconds(start, bench_clock::now()) / lookups;
+    long long indexed_found = 0;
+    start = bench_clock::now();
+    for(int i = 0; i < lookups; ++i)
+        indexed_found += indexed.contains(probes[i]);
+    double hashed = seconds(start, bench_clock::now()) / lookups;
+    std::cout << "lookup by ntel in " << size << " voci: linear scan " << linear * 1e9 << " ns, indexed_cbuffer "
+              << hashed * 1e9 << " ns (found " << found << "/" << indexed_found << ")" << std::endl;
+}
+
+/**
+@brief Inserimenti su indexed_cbuffer pieno con chiavi difficili per l'indice
+
+Chiavi int consecutive con std::hash<int> (identità) e voci tutte con lo stesso cognome
+**/
+void bench_indexed_insert(int size, int items){
+    indexed_cbuffer<int, std::identity> numbers(size);
+    bench_clock::time_point start = bench_clock::now();
+    for(int i = 0; i < items; ++i)
+        numbers.insert(i);
+    double sequential = seconds(start, bench_clock::now());
+    std::vector<voce> same;
+    for(int i = 0; i < 4096; ++i)
+        same.push_back(voce("Rossi", "Luca", std::to_string(i)));
+    indexed_cbuffer<voce, voce_cognome_key> duplicates(size);
+    start = bench_clock::now();
+    for(int i = 0; i < items; ++i)
+        duplicates.insert(same[i & 4095]);
+    double repeated = seconds(start, bench_clock::now());
+    std::cout << "indexed_cbuffer insert, " << items << " into " << size << ": sequential int keys "
+              << sequential / items * 1e9 << " ns, one repeated cognome " << repeated / items * 1e9 << " ns (count "
+              << duplicates.count("Rossi") << ")" << std::endl;
+}
+
+/**
+@brief Latenza di andata e ritorno tra due thread con due blocking_cbuffer<int>
+
+Il thread principale invia un valore su ping e attende la risposta su pong con pop_wait:
+ogni scambio passa per una transizione da vuoto a non vuoto e quindi per un risveglio.
+Stampa i percentili della latenza e, come confronto, il costo di push/pop senza contesa
+**/
+void bench_blocking_pingpong(int rounds){
+    blocking_cbuffer<int> ping(1), pong(1);
+    std::thread echo([&ping, &pong](){
+        int v;
+        do{
+            ping.pop_wait(v);
+            pong.push(v);
+        }while(v >= 0);
+    });
+    std::vector<double> latencies(rounds);
+    int v;
+    for(int i = 0; i < rounds; ++i){
+        bench_clock::time_point start = bench_clock::now();
+        ping.push(i);
+        pong.pop_wait(v);
+        latencies[i] = seconds(start, bench_clock::now());
+    }
+    ping.push(-1);
+    pong.pop_wait(v);
+    echo.join();
+    std::sort(latencies.begin(), latencies.end());
+    const double percentiles[] = {0.5, 0.9, 0.99, 0.999};
+    std::cout << "blocking_cbuffer ping-pong round trip, " << rounds << " rounds:";
+    for(double p : percentiles)
+        std::cout << " p" << p * 100 << " " << latencies[(std::size_t)(p * (rounds - 1))] * 1e6 << " us";
+    std::cout << " (sleeps " << ping.sleeps() + pong.sleeps() << ")" << std::endl;
+
+    blocking_cbuffer<int> cb(1024);
+    const long long items = 10000000;
+    long long sum = 0;
+    bench_clock::time_point start = bench_clock::now();
+    for(long long i = 0; i < items; ++i){
+        cb.push((int)i);
+        cb.try_pop(v);
+        sum += v;
+    }
+    double secs = seconds(start, bench_clock::now());
+    std::cout << "blocking_cbuffer uncontended push/pop: " << secs / items * 1e9 << " ns (sleeps "
+              << cb.sleeps() << ", checksum " << (sum & 0xff) << ")" << std::endl;
+}
+
+/**
+@brief Raddoppio della dimensione di un cbuffer pieno e "arrotolato"
+
+Confronta resize_capacity, che sposta gli elementi in due tratti, con la ricostruzione
+in un nuovo cbuffer inserendo un elemento alla volta
+**/
+template <typename T>
+void bench_resize(const char *name, int size, int rounds, T (*make)(int)){
+    double by_insert = 0, by_resize = 0;
+    for(int r = 0; r < rounds; ++r){
+        cbuffer<T> cb(size);
+        for(int i = 0; i < size + size / 3; ++i)
+            cb.insert(make(i));
+        bench_clock::time_point start = bench_clock::now();
+        cbuffer<T> bigger(size * 2);
+        for(typename cbuffer<T>::const_iterator it = cb.begin(); it != cb.end(); ++it)
+            bigger.insert(*it);
+        by_insert += seconds(start, bench_clock::now());
+        start = bench_clock::now();
+        cb.resize_capacity(size * 2);
+        by_resize += seconds(start, bench_clock::now());
+    }
+    std::cout << "grow cbuffer<" << name << "> of " << size << " to " << size * 2 << ": new cbuffer + insert "
+              << by_insert / rounds * 1e3 << " ms, resize_capacity " << by_resize / rounds * 1e3 << " ms" << std::endl;
+}
+
+int make_int(int i){
+    return i;
+}
+
+voce make_voce(int i){
+    return voce("Rossi", "Luca", "+39-0333-555-" + std::to_string(10000000 + i));
+}
+
+/**
+@brief Inserimenti in un cbuffer<int> con crescita automatica da 16 elementi a items
+**/
+void bench_auto_grow(int items){
+    bench_clock::time_point start = bench_clock::now();
+    cbuffer<int> cb(16);
+    cb.set_auto_grow(items);
+    for(int i = 0; i < items; ++i)
+        cb.insert(i);
+    double grow = seconds(start, bench_clock::now());
+    start = bench_clock::now();
+    cbuffer<int> fixed(items);
+    for(int i = 0; i < items; ++i)
+        fixed.insert(i);
+    double preallocated = seconds(start, bench_clock::now());
+    std::cout << "insert " << items << " ints: auto-grow from 16 " << grow / items * 1e9 << " ns/item, preallocated "
+              << preallocated / items * 1e9 << " ns/item" << std::endl;
+}
+
+/**
+@brief Elemento grande quattro linee di cache, per cui consume fa prefetch
+**/
+struct big_sample {
+    long long id;
+    char payload[248];
+};
+
+big_sample make_big(int i){
+    big_sample b;
+    b.id = i;
+    std::memset(b.payload, 0, sizeof(b.payload));
+    return b;
+}
+
+long long key_of(int v){
+    return v;
+}
+
+long long key_of(const big_sample &b){
+    return b.id;
+}
+
+/**
+@brief Svuotamento di un cbuffer<T> pieno: cb[0] + remove(), front() + remove() e consume
+
+@return nanosecondi per elemento dei tre metodi
+**/
+template <typename T>
+void bench_consume(const char *name, int size, int rounds, T (*make)(int)){
+    cbuffer<T> cb(size);
+    std::vector<T> source;
+    for(int i = 0; i < size; ++i)
+        source.push_back(make(i));
+    double secs[3] = {0, 0, 0};
+    long long sum = 0;
+    for(int r = 0; r < rounds; ++r)
+        for(int method = 0; method < 3; ++method){
+            cb.insert(source.begin(), source.end());
+            bench_clock::time_point start = bench_clock::now();
+            if(method == 0)
+                while(!cb.empty()){
+                    sum += key_of(cb[0]);
+                    cb.remove();
+                }
+            else if(method == 1)
+                while(!cb.empty()){
+                    sum += key_of(cb.front());
+                    cb.remove();
+                }
+            else
+                cb.consume(size, [&sum](std::span<T> run){
+                    for(std::size_t i = 0; i < run.size(); ++i)
+                        sum += key_of(run[i]);
+                });
+            secs[method] += seconds(start, bench_clock::now());
+        }
+    bench_keep(sum);
+    double items = static_cast<double>(size) * rounds;
+    std::cout << "drain cbuffer<" << name << "> of " << size << ": cb[0] + remove " << secs[0] / items * 1e9
+              << " ns/item, front + remove " << secs[1] / items * 1e9 << " ns/item, consume "
+              << secs[2] / items * 1e9 << " ns/item" << std::endl;
+}
+
+/**
+@brief std::copy e std::find sugli iteratori di un cbuffer<int> con wrap a metà,
+confrontati con le versioni segmentate di cbuffer_algo.hpp
+**/
+void bench_segmented(int size, int rounds){
+    cbuffer<int> cb(size);
+    for(int i = 0; i < size + size / 2; ++i)
+        cb.insert(i);
+    std::vector<int> out(size);
+    int missing = -1;
+    double secs[4] = {0, 0, 0, 0};
+    long long found = 0;
+    for(int r = 0; r < rounds; ++r){
+        bench_clock::time_point start = bench_clock::now();
+        std::copy(cb.begin(), cb.end(), out.begin());
+        secs[0] += seconds(start, bench_clock::now());
+        start = bench_clock::now();
+        copy_segmented(cb.begin(), cb.end(), out.begin());
+        secs[1] += seconds(start, bench_clock::now());
+        start = bench_clock::now();
+        found += std::find(cb.begin(), cb.end(), missing) - cb.begin();
+        secs[2] += seconds(start, bench_clock::now());
+        start = bench_clock::now();
+        found += find_segmented(cb.begin(), cb.end(), missing) - cb.begin();
+        secs[3] += seconds(start, bench_clock::now());
+    }
+    bench_keep(found);
+    bench_keep(out[size - 1]);
+    double items = static_cast<double>(size) * rounds;
+    std::cout << "wrapped cbuffer<int> of " << size << ": std::copy " << secs[0] / items * 1e9 << " ns/item, copy_segmented "
+              << secs[1] / items * 1e9 << " ns/item, std::find " << secs[2] / items * 1e9 << " ns/item, find_segmented "
+              << secs[3] / items * 1e9 << " ns/item" << std::endl;
+}
+
+/**
+@brief Insert e remove su un cbuffer<int> con la politica Policy
+
+Metà degli inserimenti sovrascrive, così vengono contati tutti i tipi di evento
+@return nanosecondi per operazione
+**/
+template <typename Policy>
+double stats_overhead(long long items, int size){
+    cbuffer<int, Policy> cb(size);
+    long long sum = 0;
+    bench_clock::time_point start = bench_clock::now();
+    for(long long i = 0; i < items; ++i){
+        cb.insert(static_cast<int>(i));
+        if(i & 1)
+            sum += cb.pop();
+    }
+    double secs = seconds(start, bench_clock::now());
+    bench_keep(sum);
+    return secs / (items + items / 2) * 1e9;
+}
+
+/**
+@brief Costo della raccolta di statistiche rispetto alla politica nulla
+**/
+void bench_stats(long long items, int size){
+    double none = stats_overhead<cbuffer_null_policy>(items, size);
+    double counters = stats_overhead<cbuffer_stats_policy<> >(items, size);
+    double timed = stats_overhead<cbuffer_stats_policy<true> >(items, size);
+    std::cout << "cbuffer<int> insert/pop: null policy " << none << " ns/op, stats " << counters
+              << " ns/op, stats + timestamps " << timed << " ns/op" << std::endl;
+}
+
+#ifdef __linux__
+/**
+@brief Streaming di bytes attraverso un mirrored_cbuffer
+
+Stesso schema di bench_stream_cbuffer, ma ogni blocco è copiato con una sola memcpy
+**/
+void bench_stream_mirrored(long long bytes, std::size_t size, std::size_t max_chunk){
+    mirrored_cbuffer cb(size);
+    std::vector<char> src(max_chunk), dst(max_chunk);
+    for(std::size_t i = 0; i < src.size(); ++i)
+        src[i] = (char)i;
+    chunk_sizes in(max_chunk), out(max_chunk);
+    long long produced = 0, consumed = 0;
+    unsigned long check = 0;
+    bench_clock::time_point start = bench_clock::now();
+    while(consumed < bytes){
+        std::size_t want = std::min<long long>(in.next(), bytes - produced);
+        produced += cb.insert(src.data(), want);
+        std::size_t got = cb.drain_into(dst.data(), out.next());
+        if(got)
+            check += (unsigned char)dst[got - 1];
+        consumed += got;
+    }
+    double secs = seconds(start, bench_clock::now());
+    std::cout << "mirrored_cbuffer stream: " << bytes / secs / 1e9 << " GB/s (check " << check << ")" << std::endl;
+}
+
+/**
+@brief Inserimenti in un persistent_cbuffer<int> con le diverse politiche di msync e tempo di riapertura
+
+La riapertura legge solo l'intestazione: il tempo non deve crescere con la capacità
+**/
+void bench_persistent(long long items, std::size_t size){
+    std::string path = "/tmp/cbuffer_bench_" + std::to_string(getpid()) + ".ring";
+    const persistent_sync policies[] = {sync_every_insert, sync_every_n, sync_never};
+    const char *names[] = {"every insert", "every 4096", "never"};
+    for(int p = 0; p < 3; ++p){
+        unlink(path.c_str());
+        persistent_cbuffer<int> cb(path, size, policies[p], 4096);
+        long long n = policies[p] == sync_every_insert ? items / 1000 : items;
+        bench_clock::time_point start = bench_clock::now();
+        for(long long i = 0; i < n; ++i)
+            cb.insert((int)i);
+        std::string name = "persistent_cbuffer<int> insert, msync " + std::string(names[p]);
+        report(name.c_str(), n, seconds(start, bench_clock::now()));
+    }
+    const int reopens = 1000;
+    bench_clock::time_point start = bench_clock::now();
+    std::size_t total = 0;
+    for(int i = 0; i < reopens; ++i){
+        persistent_cbuffer<int> cb(path, 0);
+        total += cb.count();
+    }
+    std::cout << "persistent_cbuffer reopen with " << size << " elements: "
+              << seconds(start, bench_clock::now()) / reopens * 1e6 << " us (" << total / reopens << " restored)" << std::endl;
+    unlink(path.c_str());
+}
+#endif
+
+/**
+@brief Valori e predicati dei microbenchmark per ogni tipo di elemento
+
+Le stringhe delle voci sono abbastanza corte da non allocare (small string optimization)
+**/
+template <typename T>
+struct micro_traits;
+
+template <>
+struct micro_traits<int> {
+    static const char *name(){ return "int"; }
+    static int make(long long i){ return static_cast<int>(i); }
+    static long long weight(int v){ return v; }
+    static bool pred(int v){ return (v & 1) == 0; }
+};
+
+template <>
+struct micro_traits<double> {
+    static const char *name(){ return "double"; }
+    static double make(long long i){ return static_cast<double>(i) * 0.5; }
+    static long long weight(double v){ return static_cast<long long>(v); }
+    static bool pred(double v){ return v > 100.0; }
+};
+
+template <>
+struct micro_traits<voce> {
+    static const char *name(){ return "voce"; }
+    static voce make(long long i){ return voce("Rossi", "Luca", std::to_string(5550000 + i % 1000000)); }
+    static long long weight(const voce &v){ return static_cast<long long>(v.ntel.size()); }
+    static bool pred(const voce &v){ return (v.ntel.back() & 1) == 0; }
+};
+
+/**
+@brief streambuf che scarta tutto, per misurare evaluate_if senza scrivere sul terminale
+**/
+struct null_streambuf: std::streambuf {
+    int overflow(int c){ return c; }
+    std::streamsize xsputn(const char *, std::streamsize n){ return n; }
+};
+
+/**
+@brief Opzioni della suite di microbenchmark
+**/
+struct micro_options {
+    double min_time; ///< Durata minima di ogni misura
+    std::string filter; ///< Sottostringa dei nomi da eseguire
+    long long max_capacity; ///< Capacità massima
+    long long max_bytes; ///< Memoria massima per gli array degli elementi di un benchmark
+    std::string format; ///< table, csv o json
+};
+
+/**
+@brief Riempie un cbuffer con capacity elementi
+**/
+template <typename T>
+void micro_fill(cbuffer<T> &cb, long long count){
+    for(long long i = 0; i < count; ++i)
+        cb.insert(micro_traits<T>::make(i));
+}
+
+/**
+@brief Microbenchmark delle operazioni di cbuffer<T> con capacità capacity
+
+Operazioni (ns/op si riferiscono a un elemento):
+- insert_nonfull: insert in un cbuffer non pieno, svuotato con remove(n) ogni capacity inserimenti
+- insert_full: insert in un cbuffer pieno, sovrascrive il più vecchio
+- remove: remove del più vecchio, il cbuffer vuoto viene riempito con un insert di intervallo
+- random_index: operator[] in posizioni casuali
+- iterate: visita con const_iterator
+- copy: costruttore per copia di un cbuffer pieno
+- assign: assegnamento per copia su un cbuffer pieno
+- evaluate_if: evaluate_if con std::cout su uno stream che scarta l'output
+- evaluate_if_into: evaluate_if_into su un vector<bool>
+Nei casi che rifanno il riempimento o lo svuotamento il costo è ammortizzato nell'operazione
+**/
+template <typename T>
+void micro_suite(bench_runner &runner, const micro_options &options, long long capacity){
+    typedef micro_traits<T> traits;
+    const std::string type = traits::name();
+    const int cap = static_cast<int>(capacity);
+    const double bytes = sizeof(T);
+    long long array_bytes = capacity * static_cast<long long>(sizeof(T));
+
+    if(runner.selected("insert_nonfull", type, capacity)){
+        cbuffer<T> cb(cap);
+        T value = traits::make(7);
+        runner.run("insert_nonfull", type, capacity, bytes, [&](long long n){
+            for(long long i = 0; i < n; ++i){
+                if(cb.full())
+                    cb.remove(cap);
+                cb.insert(value);
+            }
+            return n;
+        });
+    }
+    if(runner.selected("insert_full", type, capacity)){
+        cbuffer<T> cb(cap);
+        micro_fill(cb, capacity);
+        T value = traits::make(7);
+        runner.run("insert_full", type, capacity, bytes, [&](long long n){
+            for(long long i = 0; i < n; ++i)
+                cb.insert(value);
+            return n;
+        });
+    }
+    if(runner.selected("remove", type, capacity) && 2 * array_bytes > options.max_bytes)
+        std::cerr << "skipped " << bench_runner::name("remove", type, capacity) << ": over --max-bytes" << std::endl;
+    else if(runner.selected("remove", type, capacity)){
+        std::vector<T> source;
+        source.reserve(capacity);
+        for(long long i = 0; i < capacity; ++i)
+            source.push_back(traits::make(i));
+        cbuffer<T> cb(cap);
+        cb.insert(source.begin(), source.end());
+        runner.run("remove", type, capacity, bytes, [&](long long n){
+            for(long long i = 0; i < n; ++i){
+                if(cb.empty())
+                    cb.insert(source.begin(), source.end());
+                cb.remove();
+            }
+            return n;
+        });
+    }
+    if(runner.selected("random_index", type, capacity) || runner.selected("iterate", type, capacity) ||
+       runner.selected("copy", type, capacity) || runner.selected("assign", type, capacity) ||
+       runner.selected("evaluate_if", type, capacity) || runner.selected("evaluate_if_into", type, capacity)){
+        cbuffer<T> cb(cap);
+        micro_fill(cb, capacity + capacity / 3);
+
+        std::vector<int> indices(1 << 16);
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<int> dist(0, cap - 1);
+        for(std::size_t i = 0; i < indices.size(); ++i)
+            indices[i] = dist(gen);
+        runner.run("random_index", type, capacity, bytes, [&](long long n){
+            long long sum = 0;
+            for(long long i = 0; i < n; ++i)
+                sum += traits::weight(cb[indices[i & 0xffff]]);
+            bench_keep(sum);
+            return n;
+        });
+        runner.run("iterate", type, capacity, bytes, [&](long long n){
+            long long sum = 0, done = 0;
+            while(done < n){
+                for(typename cbuffer<T>::const_iterator it = cb.begin(); it != cb.end(); ++it)
+                    sum += traits::weight(*it);
+                done += capacity;
+            }
+            bench_keep(sum);
+            return done;
+        });
+        if(2 * array_bytes <= options.max_bytes)
+            runner.run("copy", type, capacity, bytes, [&](long long n){
+                long long done = 0;
+                while(done < n){
+                    cbuffer<T> copy(cb);
+                    bench_keep(copy);
+                    done += capacity;
+                }
+                return done;
+            });
+        else if(runner.selected("copy", type, capacity))
+            std::cerr << "skipped " << bench_runner::name("copy", type, capacity) << ": over --max-bytes" << std::endl;
+        if(3 * array_bytes <= options.max_bytes){
+            cbuffer<T> target(cap);
+            micro_fill(target, capacity);
+            runner.run("assign", type, capacity, bytes, [&](long long n){
+                long long done = 0;
+                while(done < n){
+                    target = cb;
+                    bench_keep(target);
+                    done += capacity;
+                }
+                return done;
+            });
+        }else if(runner.selected("assign", type, capacity))
+            std::cerr << "skipped " << bench_runner::name("assign", type, capacity) << ": over --max-bytes" << std::endl;
+
+        null_streambuf discard;
+        std::streambuf *previous = std::cout.rdbuf(&discard);
+        runner.run("evaluate_if", type, capacity, bytes, [&](long long n){
+            long long done = 0;
+            while(done < n){
+                evaluate_if(cb, traits::pred);
+                done += capacity;
+            }
+            return done;
+        });
+        std::cout.rdbuf(previous);
+        std::vector<bool> flags;
+        flags.reserve(capacity);
+        runner.run("evaluate_if_into", type, capacity, bytes, [&](long long n){
+            long long done = 0;
+            while(done < n){
+                flags.clear();
+                evaluate_if_into(cb, traits::pred, std::back_inserter(flags));
+                done += capacity;
+            }
+            bench_keep(flags);
+            return done;
+        });
+    }
+}
+
+/**
+@brief Suite di microbenchmark per int, double e voce con capacità da 8 a 16M
+
+@return codice di uscita del programma
+**/
+int run_micro(const micro_options &options){
+    bench_runner runner(options.min_time, options.filter);
+    for(long long capacity = 8; capacity <= options.max_capacity; capacity *= 8){
+        if(capacity * static_cast<long long>(sizeof(voce)) <= options.max_bytes)
+            micro_suite<voce>(runner, options, capacity);
+        else
+            std::cerr << "skipped voce/" << capacity << ": over --max-bytes" << std::endl;
+        micro_suite<int>(runner, options, capacity);
+        micro_suite<double>(runner, options, capacity);
+        std::cerr << "capacity " << capacity << " done" << std::endl;
+    }
+    if(options.format == "csv")
+        runner.print_csv(std::cout);
+    else if(options.format == "json")
+        runner.print_json(std::cout);
+    else
+        runner.print_table(std::cout);
+    return 0;
+}
+
+/**
+@brief Stampa l'uso del programma
+**/
+void usage(const char *program){
+    std::cerr << "usage: " << program << " [micro [--csv|--json] [--filter=text] [--min-time=seconds]"
+              << " [--max-capacity=n] [--max-bytes=n]]" << std::endl
+              << "without arguments runs the throughput benchmarks" << std::endl;
+}
+
+int main(int argc, char *argv[]){
+    if(argc > 1){
+        if(std::strcmp(argv[1], "micro") != 0){
+            usage(argv[0]);
+            return 2;
+        }
+        micro_options options;
+        options.min_time = 0.05;
+        options.max_capacity = 1 << 24;
+        options.max_bytes = 2LL << 30;
+        options.format = "table";
+        for(int i = 2; i < argc; ++i){
+            std::string arg = argv[i];
+            if(arg == "--csv" || arg == "--json")
+                options.format = arg.substr(2);
+            else if(arg.rfind("--filter=", 0) == 0)
+                options.filter = arg.substr(9);
+            else if(arg.rfind("--min-time=", 0) == 0)
+                options.min_time = std::atof(arg.c_str() + 11);
+            else if(arg.rfind("--max-capacity=", 0) == 0)
+                options.max_capacity = std::atoll(arg.c_str() + 15);
+            else if(arg.rfind("--max-bytes=", 0) == 0)
+                options.max_bytes = std::atoll(arg.c_str() + 12);
+            else{
+                usage(argv[0]);
+                return 2;
+            }
+        }
+        return run_micro(options);
+    }
+    bench_spsc(20000000, 1024);
+    bench_spsc_bulk(20000000, 1024, 64);
+    bench_mutex_cbuffer(2000000, 1024);
+    bench_mpmc_scaling(2000000, 1024);
+    bench_stream_cbuffer(1LL << 30, 1 << 16, 16384);
+#ifdef __linux__
+    bench_stream_mirrored(1LL << 30, 1 << 16, 16384);
+#endif
+    bench_reductions(1 << 20, 200);
+    bench_windowed(200000, 1024);
+    bench_windowed(20000, 1 << 16);
+    bench_filter_regex(200000);
+    bench_soa_scan(1 << 20, 20);
+    bench_phone_book(10000000, 1024);
+    bench_indexed_lookup(1 << 10);
+    bench_indexed_lookup(1 << 16);
+    bench_indexed_lookup(1 << 20);
+    bench_indexed_insert(1 << 16, 1 << 18);
+    bench_blocking_pingpong(100000);
+    bench_resize<int>("int", 1 << 20, 20, make_int);
+    bench_resize<voce>("voce", 1 << 16, 20, make_voce);
+    bench_auto_grow(1 << 22);
+    bench_stats(20000000, 1024);
+    bench_consume("int", 1 << 16, 200, make_int);
+    bench_consume("big_sample", 1 << 16, 20, make_big);
+    bench_segmented(1 << 16, 500);
+#ifdef __linux__
+    bench_persistent(10000000, 1 << 10);
+    bench_persistent(10000000, 1 << 22);
+#endif
+    return 0;
+}
@@ -0,0 +1,262 @@
+#ifndef BLOCKING_CBUFFER_H
+#define BLOCKING_CBUFFER_H
+
+#include "cbuffer.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+/**
+@file blocking_cbuffer.hpp
+@brief Dichiarazione della classe blocking_cbuffer, cbuffer thread-safe con attese bloccanti
+**/
+
+#if !defined(CBUFFER_NO_ATOMIC_WAIT) && !defined(__cpp_lib_atomic_wait)
+/**
+@brief Definita quando le attese senza timeout usano la condition variable invece di std::atomic::wait
+**/
+#define CBUFFER_NO_ATOMIC_WAIT
+#endif
+
+/**
+@brief Comportamento di blocking_cbuffer::push quando il buffer è pieno
+
+- push_wait: attende che un consumatore liberi uno slot
+- push_overwrite: sovrascrive l'elemento più vecchio come cbuffer::insert, senza attendere
+**/
+enum push_mode {
+    push_wait,
+    push_overwrite
+};
+
+/**
+@brief Buffer circolare thread-safe per più produttori e consumatori con attese bloccanti
+
+Gli elementi stanno in un cbuffer protetto da un mutex. I thread che trovano il buffer
+vuoto (consumatori) o pieno (produttori in modalità push_wait) non fanno polling ma dormono:
+senza timeout con std::atomic::wait su un contatore di epoca (futex su Linux), con timeout
+o se CBUFFER_NO_ATOMIC_WAIT è definita con una condition variable.
+L'epoca viene incrementata, e i thread in attesa svegliati, solo nelle transizioni da vuoto
+a non vuoto e da pieno a non pieno e solo se qualcuno sta aspettando: push e pop su un buffer
+né vuoto né pieno, o senza thread in attesa, prendono solo il mutex e non entrano nel kernel
+**/
+template <typename T>
+class blocking_cbuffer {
+    public:
+        typedef T value_type; ///< Definzione del tipo corrispondente al valore contenuto del buffer
+        typedef typename cbuffer<T>::size_type size_type; ///< Definzione del tipo corrispondente alla dimensione
+    private:
+        /// Lato su cui si attende: consumatori su vuoto o produttori su pieno
+        struct waiters {
+            std::atomic<unsigned> epoch; ///< Incrementata sotto lock a ogni transizione
+            int count; ///< Thread in attesa, protetto dal mutex
+            std::condition_variable cv; ///< Usata per le attese con timeout
+
+            waiters(): epoch(0), count(0), cv() {}
+        };
+
+        mutable std::mutex _mutex; ///< Protegge _elements, _count e i contatori di attesa
+        cbuffer<T> _elements; ///< Elementi
+        size_type _count; ///< Numero di elementi
+        waiters _not_empty; ///< Attese dei consumatori
+        waiters _not_full; ///< Attese dei produttori
+        std::atomic<unsigned long> _sleeps; ///< Volte in cui un thread si è addormentato
+
+        blocking_cbuffer(const blocking_cbuffer &other) = delete;
+        blocking_cbuffer &operator=(const blocking_cbuffer &other) = delete;
+
+        /// Chiamata sotto lock: nuova epoca, true se c'è qualcuno da svegliare
+        static bool transition(waiters &w){
+            w.epoch.fetch_add(1, std::memory_order_release);
+            return w.count > 0;
+        }
+
+        /// Chiamata dopo aver rilasciato il lock
+        static void wake(waiters &w){
+#ifndef CBUFFER_NO_ATOMIC_WAIT
+            w.epoch.notify_all();
+#endif
+            w.cv.notify_all();
+        }
+
+        /**
+        @brief Attende la transizione successiva a epoch su w
+
+        lock è acquisito all'ingresso e all'uscita
+        @return false se deadline è passata
+        **/
+        template <typename Deadline>
+        bool sleep(std::unique_lock<std::mutex> &lock, waiters &w, const Deadline *deadline){
+            unsigned epoch = w.epoch.load(std::memory_order_relaxed);
+            ++w.count;
+            _sleeps.fetch_add(1, std::memory_order_relaxed);
+            bool woken = true;
+            if(deadline)
+                woken = w.cv.wait_until(lock, *deadline, [&w, epoch](){
+                    return w.epoch.load(std::memory_order_relaxed) != epoch;
+                });
+            else{
+#ifndef CBUFFER_NO_ATOMIC_WAIT
+                lock.unlock();
+                w.epoch.wait(epoch, std::memory_order_acquire);
+                lock.lock();
+#else
+                w.cv.wait(lock, [&w, epoch](){ return w.epoch.load(std::memory_order_relaxed) != epoch; });
+#endif
+            }
+            --w.count;
+            return woken;
+        }
+
+        template <typename V, typename Deadline>
+        insert_result push_impl(V &&value, push_mode mode, const Deadline *deadline, bool wait){
+            std::unique_lock<std::mutex> lock(_mutex);
+            if(_elements.size() == 0)
+                return insert_rejected;
+            while(mode == push_wait && _count == _elements.size())
+                if(!wait || !sleep(lock, _not_full, deadline))
+                    return insert_rejected;
+            insert_result r = _elements.insert(std::forward<V>(value));
+            bool wake_consumers = false;
+            if(r == insert_added && _count++ == 0)
+                wake_consumers = transition(_not_empty);
+            lock.unlock();
+            if(wake_consumers)
+                wake(_not_empty);
+            return r;
+        }
+
+        template <typename Deadline>
+        bool pop_impl(T &out, const Deadline *deadline, bool wait){
+            std::unique_lock<std::mutex> lock(_mutex);
+            while(_count == 0)
+                if(!wait || !sleep(lock, _not_empty, deadline))
+                    return false;
+            out = _elements.pop();
+            bool wake_producers = false;
+            if(_count-- == _elements.size())
+                wake_producers = transition(_not_full);
+            lock.unlock();
+            if(wake_producers)
+                wake(_not_full);
+            return true;
+        }
+
+        typedef std::chrono::steady_clock::time_point deadline_type;
+
+    public:
+        /**
+        @brief Costruttore con capacità
+
+        @param size Capacità del buffer
+        **/
+        explicit blocking_cbuffer(size_type size): _mutex(), _elements(size), _count(0),
+            _not_empty(), _not_full(), _sleeps(0) {}
+
+        /**
+        @brief Inserimento di un elemento
+
+        Con push_wait, se il buffer è pieno, attende che si liberi uno slot;
+        con push_overwrite sovrascrive il più vecchio
+        @param value Valore da inserire
+        @param mode Comportamento a buffer pieno
+        @return insert_added, insert_overwritten o insert_rejected se la capacità è 0
+        **/
+        insert_result push(const T &value, push_mode mode = push_wait){
+            return push_impl(value, mode, static_cast<const deadline_type *>(0), true);
+        }
+
+        /**
+        @brief Inserimento per spostamento di un elemento
+        **/
+        insert_result push(T &&value, push_mode mode = push_wait){
+            return push_impl(std::move(value), mode, static_cast<const deadline_type *>(0), true);
+        }
+
+        /**
+        @brief Inserimento con attesa limitata
+
+        Se il buffer resta pieno per tutto timeout l'elemento non viene inserito
+        @param value Valore da inserire
+        @param timeout Attesa massima
+        @return insert_added o insert_rejected se il tempo è scaduto o la capacità è 0
+        **/
+        template <typename Rep, typename Period>
+        insert_result push(const T &value, const std::chrono::duration<Rep, Period> &timeout){
+            std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+            return push_impl(value, push_wait, &deadline, true);
+        }
+
+        /**
+        @brief Inserimento senza attesa
+
+        @return false se il buffer è pieno
+        **/
+        bool try_push(const T &value){
+            return push_impl(value, push_wait, static_cast<const deadline_type *>(0), false) != insert_rejected;
+        }
+
+        /**
+        @brief Estrazione dell'elemento più vecchio, attendendo se il buffer è vuoto
+
+        @param out Destinazione dell'elemento
+        @return sempre true
+        **/
+        bool pop_wait(T &out){
+            return pop_impl(out, static_cast<const deadline_type *>(0), true);
+        }
+
+        /**
+        @brief Estrazione con attesa limitata
+
+        @param out Destinazione dell'elemento
+        @param timeout Attesa massima
+        @return false se il buffer è rimasto vuoto per tutto timeout
+        **/
+        template <typename Rep, typename Period>
+        bool pop_wait(T &out, const std::chrono::duration<Rep, Period> &timeout){
+            std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+            return pop_impl(out, &deadline, true);
+        }
+
+        /**
+        @brief Estrazione senza attesa
+
+        @return false se il buffer è vuoto
+        **/
+        bool try_pop(T &out){
+            return pop_impl(out, static_cast<const deadline_type *>(0), false);
+        }
+
+        /**
+        @brief Capacità del buffer
+        **/
+        size_type size() const {
+            return _elements.size();
+        }
+
+        /**
+        @brief Numero di elementi (fotografia)
+        **/
+        size_type count() const {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _count;
+        }
+
+        /**
+        @brief Controllo se il buffer è vuoto (fotografia)
+        **/
+        bool empty() const {
+            return count() == 0;
+        }
+
+        /**
+        @brief Numero di volte in cui un produttore o un consumatore si è addormentato
+        **/
+        unsigned long sleeps() const {
+            return _sleeps.load(std::memory_order_relaxed);
+        }
+};
+
+#endif
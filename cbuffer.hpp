@@ -7,47 +7,253 @@
 #include <stdexcept>
 #include <iterator>
 #include <cstddef>
+#include <atomic>
+#include <thread>
+#include <new>
+#include <utility>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <concepts>
+#include <compare>
+#include <type_traits>
+#include <cstring>
+#include <functional>
+#include <vector>
 
 /**
 @file cbuffer.hpp
 @brief Dichiarazione della classe cbuffer
 **/
 
+/**
+@brief Esito di un inserimento nel cbuffer
+
+- insert_added: l'elemento è stato aggiunto in coda
+- insert_overwritten: il cbuffer era pieno e l'elemento ha sovrascritto quello più vecchio
+- insert_rejected: il cbuffer ha dimensione 0 e l'elemento non è stato inserito
+**/
+enum insert_result {
+    insert_added,
+    insert_overwritten,
+    insert_rejected
+};
+
+#ifndef CBUFFER_CACHE_LINE
+/**
+@brief Dimensione di una linea di cache
+
+Usata per separare gli indici atomici dei buffer concorrenti ed evitare false sharing,
+e come passo del prefetch software, può essere ridefinita in fase di compilazione
+**/
+#define CBUFFER_CACHE_LINE 64
+#endif
+
+#ifndef CBUFFER_PREFETCH_BYTES
+/**
+@brief Byte di un tratto richiesti in anticipo alla cache da consume e for_each_batch
+
+Il prefetch avviene solo per elementi grandi almeno una linea di cache; 0 lo disabilita
+**/
+#define CBUFFER_PREFETCH_BYTES 512
+#endif
+
+/**
+@brief Riconoscimento degli adattatori di iteratori attraversati da cbuffer::insert per trovare la sorgente
+**/
+template <typename It>
+struct cbuffer_adaptor {
+    static constexpr bool reverse = false;
+    static constexpr bool move = false;
+};
+
+template <typename It>
+struct cbuffer_adaptor<std::reverse_iterator<It> > {
+    static constexpr bool reverse = true;
+    static constexpr bool move = false;
+};
+
+template <typename It>
+struct cbuffer_adaptor<std::move_iterator<It> > {
+    static constexpr bool reverse = false;
+    static constexpr bool move = true;
+};
+
+/**
+@brief Politica di osservazione di default del cbuffer
+
+Riceve gli eventi di inserimento, sovrascrittura, rimozione e rifiuto senza fare nulla:
+le chiamate vengono eliminate dal compilatore e cbuffer non richiede operator<< su T.
+Una politica personalizzata deve esporre gli stessi metodi.
+**/
+struct cbuffer_null_policy {
+    /// Elemento aggiunto in coda, count è il nuovo numero di elementi
+    template <typename T>
+    void on_insert(const T &, int) {}
+
+    /// Elemento che ha sovrascritto il più vecchio a cbuffer pieno
+    template <typename T>
+    void on_overwrite(const T &, int) {}
+
+    /// Elemento più vecchio rimosso, count è il nuovo numero di elementi
+    void on_remove(int) {}
+
+    /// Inserimento di una sequenza: added elementi aggiunti e overwritten sovrascritti
+    void on_insert_n(int, int, int) {}
+
+    /// Rimozione o estrazione dei removed elementi più vecchi
+    void on_remove_n(int, int) {}
+
+    /// Inserimento rifiutato perché il cbuffer ha dimensione 0
+    void on_reject_insert() {}
+
+    /// Rimozione rifiutata perché il cbuffer è vuoto
+    void on_reject_remove() {}
+};
+
+/**
+@brief Politica di osservazione che conta gli eventi
+
+Mantiene un contatore per ogni tipo di evento, leggibile tramite cbuffer::policy()
+**/
+struct cbuffer_counting_policy {
+    unsigned long inserts; ///< Elementi aggiunti senza sovrascrivere
+    unsigned long overwrites; ///< Elementi aggiunti sovrascrivendo il più vecchio
+    unsigned long removes; ///< Elementi rimossi
+    unsigned long rejects; ///< Inserimenti e rimozioni rifiutati
+
+    cbuffer_counting_policy(): inserts(0), overwrites(0), removes(0), rejects(0) {}
+
+    template <typename T>
+    void on_insert(const T &, int) { ++inserts; }
+
+    template <typename T>
+    void on_overwrite(const T &, int) { ++overwrites; }
+
+    void on_remove(int) { ++removes; }
+
+    void on_insert_n(int added, int overwritten, int) { inserts += added; overwrites += overwritten; }
+
+    void on_remove_n(int removed, int) { removes += removed; }
+
+    void on_reject_insert() { ++rejects; }
+
+    void on_reject_remove() { ++rejects; }
+};
+
+/**
+@brief Politica di osservazione che scrive gli eventi su uno stream
+
+Riproduce i messaggi storici di cbuffer, di default su std::cout;
+richiede operator<< sul tipo degli elementi
+**/
+struct cbuffer_logging_policy {
+    std::ostream *os; ///< Stream su cui scrivere gli eventi
+
+    cbuffer_logging_policy(): os(&std::cout) {}
+
+    explicit cbuffer_logging_policy(std::ostream &out): os(&out) {}
+
+    template <typename T>
+    void on_insert(const T &value, int count) {
+        *os << "Added " << value << ", end:" << count << std::endl;
+    }
+
+    template <typename T>
+    void on_overwrite(const T &value, int count) {
+        *os << "Overwritten oldest with " << value << ", end:" << count << std::endl;
+    }
+
+    void on_remove(int count) {
+        *os << "Removed first element, end:" << count << std::endl;
+    }
+
+    void on_insert_n(int added, int overwritten, int count) {
+        *os << "Added " << added + overwritten << " elements, overwritten " << overwritten
+            << ", end:" << count << std::endl;
+    }
+
+    void on_remove_n(int removed, int count) {
+        *os << "Removed " << removed << " elements, end:" << count << std::endl;
+    }
+
+    void on_reject_insert() {
+        *os << "Impossible to add element, the cbuffer size is 0" << std::endl;
+    }
+
+    void on_reject_remove() {
+        *os << "The cbuffer is already empty or the size is 0" << std::endl;
+    }
+};
+
+/**
+@brief Iteratore contiguo su elementi di tipo T
+
+Soddisfatto da puntatori e iteratori di vector, array e span: la sequenza può essere
+copiata con memcpy
+**/
+template <typename iteratorQ, typename T>
+concept cbuffer_contiguous_iterator = std::contiguous_iterator<iteratorQ> &&
+    std::same_as<std::remove_cv_t<std::iter_value_t<iteratorQ> >, T>;
+
 /**
 @brief Buffer circolare
 
-Classe templata che rapresenta un buffer circolare, la dimensione è data o 0 di default
+Classe templata che rapresenta un buffer circolare, la dimensione è data o 0 di default.
+Il parametro Policy riceve gli eventi del buffer (vedi cbuffer_null_policy),
+di default non fa nulla. La memoria degli elementi è ottenuta tramite Allocator
+usando std::allocator_traits, quindi sono supportati anche gli allocatori pmr (vedi pmr_cbuffer)
 **/ 
-template <typename T>
-class cbuffer{
+template <typename T, typename Policy = cbuffer_null_policy, typename Allocator = std::allocator<T> >
+class cbuffer: private Policy{
     public:
         typedef T value_type; ///< Definzione del tipo corrispondente al valore contenuto del cbuffer
         typedef int size_type; ///< Definzione del tipo corrispondente a size, dimensionde del cbuffer
+        typedef Policy policy_type; ///< Definizione del tipo della politica di osservazione
+        typedef Allocator allocator_type; ///< Definizione del tipo dell'allocatore
     private:
+        typedef std::allocator_traits<Allocator> alloc_traits; ///< Interfaccia uniforme verso l'allocatore
+
         size_type _end; ///< Numero di elementi inseriti
-        T *_buffer;	///< Puntatore all'array
+        T *_buffer;	///< Puntatore all'array, memoria non inizializzata: solo gli _end slot logici contengono oggetti
         size_type _size; ///< Dimensione dell'array
+        size_type _start; ///< Indice fisico dell'elemento più vecchio (testa del ring)
+        Allocator _alloc; ///< Allocatore usato per l'array e per costruire gli elementi
+        size_type _grow_limit = 0; ///< Dimensione massima raggiungibile crescendo, vedi set_auto_grow
+        double _growth = 2; ///< Fattore di crescita geometrica
     public:
         /**
 		@brief Costruttore di default
 
 		Costruttore di default usato per creare un cbuffer vuoto con size 0
 		**/
-        cbuffer(): _size(0), _buffer(0), _end(0){
+        cbuffer(): _size(0), _buffer(0), _end(0), _start(0), _alloc(){
             #ifndef NDEBUG
             std::cout << "cbuffer::cbuffer()" << std::endl;
             #endif
         }
 
+        /**
+		@brief Costruttore di default con allocatore
+
+		Crea un cbuffer vuoto con size 0 che userà alloc per le allocazioni successive
+		@param alloc Allocatore da usare
+		**/
+        explicit cbuffer(const Allocator &alloc): _size(0), _buffer(0), _end(0), _start(0), _alloc(alloc){
+        }
+
         /**
 		@brief Costruttore secondario con size
 
-		Costruttore secondario dove è possibile specificare la size del cbuffer in fase di costruzione
+		Costruttore secondario dove è possibile specificare la size del cbuffer in fase di costruzione,
+		viene allocata solo la memoria: nessun elemento è costruito finché non viene inserito
 		@param size Dimensione del cbuffer da istanziare 
+		@param alloc Allocatore da usare
 		**/
-        explicit cbuffer(size_type size): _size(0), _buffer(0), _end(0){
+        explicit cbuffer(size_type size, const Allocator &alloc = Allocator()):
+            _size(0), _buffer(0), _end(0), _start(0), _alloc(alloc){
             if(size >= 0){
-                _buffer = new T[size];
+                _buffer = allocate(size);
                 _size = size;
 
                 #ifndef NDEBUG
@@ -63,15 +269,16 @@ class cbuffer{
 		e il valore con cui verrano instanziate tutti i suoi elementi
 		@param size Dimensione del cbuffer da instanziare
 		@param value Valore usato per instanziare gli elementi del cbuffer
+		@param alloc Allocatore da usare
 		**/
-        cbuffer(size_type size, const T &value): _size(0), _buffer(0), _end(0){
+        cbuffer(size_type size, const T &value, const Allocator &alloc = Allocator()):
+            _size(0), _buffer(0), _end(0), _start(0), _alloc(alloc){
             if(size >= 0){
-                _buffer = new T[size];
+                _buffer = allocate(size);
                 _size = size;
                 try{
-                    for(size_type i = 0; i < size; ++i)
-                        _buffer[i] = value;
-                    _end = _size;
+                    for(; _end < size; ++_end)
+                        alloc_traits::construct(_alloc, _buffer + _end, value);
                 }catch(...){
                     clear();
                     throw;
@@ -86,19 +293,20 @@ class cbuffer{
 		@brief Costruttore secondario con due iteratori
 
 		Costruttore secondario con due iteratori di inizio e fine di una sequenza generica di dati Q e la size,
-		la sequenza di dati andrà a riempire con la sequenza di dati il cbuffer instanziato della data dimensione
+		la sequenza di dati andrà a riempire con la sequenza di dati il cbuffer instanziato della data dimensione,
+		se la sequenza è più lunga restano solo gli ultimi size elementi
 		@param size Dimensione del cbuffer da instanziare
 		@param begin Iteratore che punta al primo elemento della sequenza di dati generici
 		@param end Iteratore che punta alla fine della sequenza di dati generici 
+		@param alloc Allocatore da usare
 		**/
         template <typename iteratorQ>
-        cbuffer(size_type size, iteratorQ begin, iteratorQ finish):
-            _size(0), _buffer(0), _end(0){
-            _buffer = new T[size];
+        cbuffer(size_type size, iteratorQ begin, iteratorQ finish, const Allocator &alloc = Allocator()):
+            _size(0), _buffer(0), _end(0), _start(0), _alloc(alloc){
+            _buffer = allocate(size);
             _size = size;
             try{
-                for(; begin != finish; ++begin)
-                    insert(*begin);
+                insert(begin, finish);
             }catch(...){
                 clear();
                 throw;
@@ -109,43 +317,62 @@ class cbuffer{
 		@brief Costruttore per copia
 
 		Costruttore per copia, permette di instanziare un cbuffer con i dati presenti su un altro cbuffer
-		passato
+		passato, gli elementi vengono copiati in ordine logico (dal più vecchio al più recente)
+		a partire dalla posizione 0 del nuovo array.
+		L'allocatore è ottenuto con select_on_container_copy_construction
 		@param other Cbuffer usato per la creazione di quello corrente
 		**/
-        cbuffer(const cbuffer &other): _size(0), _end(0), _buffer(0){
-            _buffer = new T[other._size];
-            _size = other._size;
-            _end = other._end;
-
-            try {
-                if(!empty()){
-                    size_type index = 0;//indice in modulo
-                    for(size_type i=0; i<_end; ++i){
-                        _buffer[i] = other._buffer[i];
-                    }
-                }
-            }
-            catch(...) {
-                clear();
-                throw;
-            }
+        cbuffer(const cbuffer &other): Policy(other), _size(0), _end(0), _buffer(0), _start(0),
+            _alloc(alloc_traits::select_on_container_copy_construction(other._alloc)),
+            _grow_limit(other._grow_limit), _growth(other._growth){
+            copy_from(other);
 
             #ifndef NDEBUG
             std::cout << "cbuffer::cbuffer(const cbuffer&)" << std::endl;
             #endif
         }
 
+        /**
+		@brief Costruttore per copia con allocatore
+
+		Come il costruttore per copia, ma il nuovo cbuffer usa alloc
+		@param other Cbuffer usato per la creazione di quello corrente
+		@param alloc Allocatore da usare
+		**/
+        cbuffer(const cbuffer &other, const Allocator &alloc): Policy(other), _size(0), _end(0), _buffer(0), _start(0),
+            _alloc(alloc), _grow_limit(other._grow_limit), _growth(other._growth){
+            copy_from(other);
+        }
+
+        /**
+		@brief Costruttore per spostamento
+
+		Prende possesso dell'array di other senza copiare né allocare,
+		other rimane un cbuffer vuoto di dimensione 0
+		@param other Cbuffer da cui vengono spostati i dati
+		**/
+        cbuffer(cbuffer &&other) noexcept: Policy(std::move(static_cast<Policy &>(other))),
+            _end(other._end), _buffer(other._buffer), _size(other._size), _start(other._start),
+            _alloc(std::move(other._alloc)), _grow_limit(other._grow_limit), _growth(other._growth){
+            other._buffer = 0;
+            other._size = 0;
+            other._end = 0;
+            other._start = 0;
+        }
+
         /**
 		@brief Operatore assegnamento
 		
-		Operatore assegnamento, permette la copia di dati di un altro cbuffer tramite swap
+		Operatore assegnamento, permette la copia di dati di un altro cbuffer tramite swap.
+		L'allocatore di other viene adottato solo se propagate_on_container_copy_assignment
  		@param other Cbuffer da cui verrano copia i dati
 		@return riferimento a this
 		**/
         cbuffer &operator=(const cbuffer &other) {
             if (this != &other) {
-                cbuffer tmp(other);
-                this->swap(tmp);
+                cbuffer tmp(other, alloc_traits::propagate_on_container_copy_assignment::value ?
+                    other._alloc : _alloc);
+                swap_all(tmp);
             }
 
             #ifndef NDEBUG
@@ -155,6 +382,32 @@ class cbuffer{
             return *this;
 	    }
 
+        /**
+		@brief Operatore assegnamento per spostamento
+
+		Scambia i dati con other, che libererà quelli precedenti di this alla sua distruzione.
+		Se l'allocatore non si propaga ed è diverso da quello di other, gli elementi vengono
+		spostati uno a uno in un nuovo array ottenuto dall'allocatore di this
+ 		@param other Cbuffer da cui verrano spostati i dati
+		@return riferimento a this
+		**/
+        cbuffer &operator=(cbuffer &&other)
+            noexcept(alloc_traits::propagate_on_container_move_assignment::value ||
+                     alloc_traits::is_always_equal::value) {
+            if (this != &other) {
+                if(alloc_traits::propagate_on_container_move_assignment::value || _alloc == other._alloc){
+                    cbuffer tmp(std::move(other));
+                    swap_all(tmp);
+                }else{
+                    cbuffer tmp(_alloc);
+                    static_cast<Policy &>(tmp) = std::move(static_cast<Policy &>(other));
+                    tmp.move_from(other);
+                    swap_all(tmp);
+                }
+            }
+            return *this;
+	    }
+
 	    /**
 		@brief Distruttore
 
@@ -171,22 +424,66 @@ class cbuffer{
 		@brief Swap tra due cbuffer
 
 		Permette lo scambio dei dati tra il cbuffer corrente e quello passato come parametro,
-		nello specifico vengono scambiati: size, il puntatore al buffer e il numero di elementi inseriti
+		nello specifico vengono scambiati: size, il puntatore al buffer, il numero di elementi inseriti,
+		l'indice di testa e le impostazioni di crescita. Gli allocatori vengono scambiati solo se propagate_on_container_swap,
+		altrimenti devono essere uguali
 		@param other Cbuffer con cui verrano scambiati i dati
 		**/		
-		void swap(cbuffer &other) {
-		    std::swap(other._size, this->_size);
-		    std::swap(other._buffer, this->_buffer);
-		    std::swap(other._end, this->_end);
+		void swap(cbuffer &other) noexcept {
+		    using std::swap;
+		    swap(other._size, this->_size);
+		    swap(other._buffer, this->_buffer);
+		    swap(other._end, this->_end);
+		    swap(other._start, this->_start);
+		    swap(other._grow_limit, this->_grow_limit);
+		    swap(other._growth, this->_growth);
+		    swap(static_cast<Policy &>(other), static_cast<Policy &>(*this));
+		    if constexpr(alloc_traits::propagate_on_container_swap::value)
+		        swap(other._alloc, this->_alloc);
 	    }
 
+		/**
+		@brief Allocatore del cbuffer
+
+		@return una copia dell'allocatore usato
+		**/
+		allocator_type get_allocator() const {
+		    return _alloc;
+		}
+
+		/**
+		@brief Accesso alla politica di osservazione
+
+		@return riferimento alla politica, ad esempio per leggere i contatori di cbuffer_counting_policy
+		**/
+		Policy &policy() {
+		    return *this;
+		}
+
+		/**
+		@brief Accesso alla politica di osservazione in sola lettura
+		**/
+		const Policy &policy() const {
+		    return *this;
+		}
+
+		/**
+		@brief Fotografia delle statistiche raccolte dalla politica
+
+		Disponibile solo se la politica espone stats(capacity, count), come cbuffer_stats_policy
+		@return le statistiche, con capacità e numero di elementi attuali
+		**/
+		auto stats() const requires requires(const Policy &p){ p.stats(0, 0); } {
+		    return Policy::stats(_size, _end);
+		}
+
 		/**
 		@brief Controllo se il cbuffer è vuoto
 
 		Ritorna true se il cbuffer non ha elementi al suo interno, altrimenti ritorna false, 
 		@return true se il cbuffer è vuoto altrimenti false 
 		**/
-        bool empty(){
+        bool empty() const {
             return _end == 0;
         }
 
@@ -199,43 +496,371 @@ class cbuffer{
         size_type size() const {
 		    return _size;
 	    }
+
+		/**
+		@brief Cambio della dimensione del cbuffer
+
+		Alloca un nuovo array di dimensione n e vi porta gli elementi in ordine logico a partire
+		dalla posizione 0, in al più due tratti contigui (memcpy se T è banalmente copiabile);
+		se n è minore del numero di elementi restano solo gli n più recenti, i più vecchi vengono
+		rimossi. Gli elementi sono spostati se il costruttore per spostamento non lancia eccezioni,
+		altrimenti copiati: in caso di eccezione il cbuffer resta invariato.
+		Iteratori, span e riferimenti agli elementi non sono più validi
+		@param n Nuova dimensione, se negativa vale 0
+		**/
+	    void resize_capacity(size_type n){
+			if(n < 0)
+				n = 0;
+			if(n == _size)
+				return;
+			size_type keep = std::min(_end, n);
+			T *buffer = allocate(n);
+			try{
+				relocate_into(buffer, physical_of(_end - keep), keep);
+			}catch(...){
+				deallocate(buffer, n);
+				throw;
+			}
+			size_type dropped = _end - keep;
+			replace_array(buffer, n, keep);
+			if(dropped > 0)
+				Policy::on_remove_n(dropped, keep);
+	    }
+
+		/**
+		@brief Aumento della dimensione del cbuffer
+
+		Come resize_capacity, ma solo se n è maggiore della dimensione attuale.
+		Da non confondere con reserve, che prenota slot liberi in coda
+		@param n Dimensione minima richiesta
+		**/
+	    void reserve_capacity(size_type n){
+			if(n > _size)
+				resize_capacity(n);
+	    }
+
+		/**
+		@brief Crescita automatica invece della sovrascrittura
+
+		Finché la dimensione è minore di limit, un inserimento a cbuffer pieno moltiplica la
+		dimensione per factor (almeno di 1, senza superare limit) invece di sovrascrivere il più
+		vecchio; raggiunto limit il cbuffer torna a sovrascrivere. Il costo degli spostamenti è
+		ammortizzato O(1) per inserimento. La dimensione può essere riportata indietro con
+		resize_capacity. Con limit non maggiore della dimensione la crescita è disattivata.
+		Se factor non è maggiore di 1 genera un eccezione invalid_argument
+		@param limit Dimensione massima raggiungibile crescendo
+		@param factor Fattore di crescita geometrica
+		**/
+	    void set_auto_grow(size_type limit, double factor = 2){
+			if(!(factor > 1))
+				throw std::invalid_argument("Growth factor must be greater than 1");
+			_grow_limit = limit;
+			_growth = factor;
+	    }
+
+		/**
+		@brief Dimensione massima raggiungibile con la crescita automatica, 0 se mai impostata
+		**/
+	    size_type auto_grow_limit() const {
+			return _grow_limit;
+	    }
 		
 		/**
 		@brief Inserimento di un elemento in coda al cbuffer
 
 		Permette l'inserimento di un valore in coda al cbuffer, 
 		se il cbuffer è pieno il valore inserito andrà a sovrascrivere quello più vecchio già presente del cbuffer,
-		se il cbuffer ha dimensione 0 non è possibile inserire il valore 
-		**/
-	    void insert(const T &value){
-			if(_size > 0){
-		        if(!full()){
-		            _buffer[_end] = value;
-		            _end ++;
-		        }else{
-		            shift_left();
-		            _buffer[_end - 1] = value;
-		        }
-		        //std::cout << "Start:" << _start << std::endl;
-		        std::cout << "Added " << value << ", end:" << _end << std::endl;
-			}else
-				std::cout << "Impossible to add element, the cbuffer size is 0" 
-							<< std::endl;
+		se il cbuffer ha dimensione 0 non è possibile inserire il valore.
+		Il costo è O(1): in caso di sovrascrittura viene solo avanzato l'indice di testa
+		@param value Valore da inserire
+		@return insert_added, insert_overwritten se è stato sovrascritto l'elemento più vecchio,
+		insert_rejected se il cbuffer ha dimensione 0
+		**/
+	    insert_result insert(const T &value){
+			if(full() && !can_grow() && std::addressof(value) == _buffer + _start){
+				// value è l'elemento più vecchio: diventa il più recente senza copie
+				_start = next(_start);
+				Policy::on_overwrite(value, _end);
+				return insert_overwritten;
+			}
+			return emplace(value);
+	    }
+
+		/**
+		@brief Inserimento per spostamento di un elemento in coda al cbuffer
+
+		Come insert(const T &), ma l'elemento viene costruito spostando value
+		@param value Valore da spostare nel cbuffer
+		@return insert_added, insert_overwritten se è stato sovrascritto l'elemento più vecchio,
+		insert_rejected se il cbuffer ha dimensione 0
+		**/
+	    insert_result insert(T &&value){
+			if(full() && !can_grow() && std::addressof(value) == _buffer + _start){
+				_start = next(_start);
+				Policy::on_overwrite(value, _end);
+				return insert_overwritten;
+			}
+			return emplace(std::move(value));
+	    }
+
+		/**
+		@brief Costruzione di un elemento in coda al cbuffer
+
+		Costruisce l'elemento direttamente nello slot di coda passando args al costruttore di T,
+		senza oggetti temporanei. Se il cbuffer è pieno l'elemento più vecchio viene distrutto
+		e il nuovo costruito al suo posto; se la costruzione lancia un'eccezione l'elemento
+		più vecchio risulta rimosso.
+		@pre Se il cbuffer è pieno args non deve riferirsi all'elemento più vecchio
+		@param args Argomenti del costruttore di T
+		@return insert_added, insert_overwritten se è stato sovrascritto l'elemento più vecchio,
+		insert_rejected se il cbuffer ha dimensione 0
+		**/
+		template <typename... Args>
+	    insert_result emplace(Args&&... args){
+			if((_size == 0 || full()) && can_grow()){
+				grow_emplace(std::forward<Args>(args)...);
+				return insert_added;
+			}
+			if(_size == 0){
+				Policy::on_reject_insert();
+				return insert_rejected;
+			}
+	        if(!full()){
+	            T *slot = _buffer + physical(_end);
+	            alloc_traits::construct(_alloc, slot, std::forward<Args>(args)...);
+	            _end ++;
+	            Policy::on_insert(*slot, _end);
+	            return insert_added;
+	        }
+	        T *slot = _buffer + _start;
+	        alloc_traits::destroy(_alloc, slot);
+	        try{
+	            alloc_traits::construct(_alloc, slot, std::forward<Args>(args)...);
+	        }catch(...){
+	            _start = next(_start);
+	            _end--;
+	            throw;
+	        }
+	        _start = next(_start);
+	        Policy::on_overwrite(*slot, _end);
+	        return insert_overwritten;
 	    }
 		
 		/**
 		@brief Rimozione di un elemento dal cbuffer
 		
-		Permette la rimozione dell'elemento il testa al cbuffer, cioè quello più vecchio 
+		Permette la rimozione dell'elemento il testa al cbuffer, cioè quello più vecchio,
+		in tempo costante avanzando l'indice di testa
+		@return true se un elemento è stato rimosso, false se il cbuffer era vuoto
+		**/
+	    bool remove(){
+			if(empty()){
+				Policy::on_reject_remove();
+				return false;
+			}
+	        alloc_traits::destroy(_alloc, _buffer + _start);
+	        _start = next(_start);
+	        _end--;
+	        Policy::on_remove(_end);
+	        return true;
+	    }
+
+		/**
+		@brief Estrazione dell'elemento più vecchio
+
+		Sposta fuori dal cbuffer l'elemento in testa e lo rimuove,
+		se il cbuffer è vuoto genera un eccezione out_of_range
+		@return l'elemento più vecchio
+		**/
+	    T pop(){
+			if(empty())
+				throw std::out_of_range("Pop from empty cbuffer");
+			T value(std::move(_buffer[_start]));
+	        alloc_traits::destroy(_alloc, _buffer + _start);
+	        _start = next(_start);
+	        _end--;
+	        Policy::on_remove(_end);
+	        return value;
+	    }
+
+		/**
+		@brief Inserimento di una sequenza in coda al cbuffer
+
+		Inserisce in ordine gli elementi di [first, last), sovrascrivendo i più vecchi se serve.
+		Con iteratori forward la copia avviene in al più due tratti contigui (prima e dopo
+		il punto di wrap), con memcpy se T è banalmente copiabile e la sequenza è contigua;
+		se la sequenza è più lunga della dimensione vengono scritti solo gli ultimi size() elementi.
+		Con iteratori di solo input gli elementi vengono inseriti uno alla volta.
+		La sequenza può provenire da questo cbuffer (iteratori, anche inversi o move_iterator,
+		puntatori o span sui suoi elementi): se l'inserimento sovrascrive o fa crescere il
+		cbuffer viene prima copiata in un vettore temporaneo, perché gli elementi sovrascritti
+		sono distrutti prima di costruire i nuovi
+		@pre se la sequenza proviene da questo cbuffer tramite altri adattatori di iteratori,
+		non deve sovrapporsi agli elementi sovrascritti
+		@param first Iteratore al primo elemento da inserire
+		@param last Iteratore alla fine della sequenza
+		@return il numero di elementi scritti nel cbuffer
+		**/
+		template <typename iteratorQ>
+		    requires std::input_iterator<iteratorQ>
+	    size_type insert(iteratorQ first, iteratorQ last){
+			if constexpr(!std::forward_iterator<iteratorQ>){
+				size_type n = 0;
+				for(; first != last && _size > 0; ++first, ++n)
+					emplace(*first);
+				if(first != last)
+					Policy::on_reject_insert();
+				return n;
+			}else{
+				typename std::iterator_traits<iteratorQ>::difference_type total = std::distance(first, last);
+				if(total <= 0)
+					return 0;
+				if(total > _size - _end && aliases(first, total)){
+					std::vector<T> staged(first, last);
+					return insert(std::make_move_iterator(staged.begin()), std::make_move_iterator(staged.end()));
+				}
+				if(total > _size - _end && can_grow()){
+					// cresce una volta sola per tutta la sequenza
+					size_type want = total >= _grow_limit - _end ? _grow_limit : _end + static_cast<size_type>(total);
+					reserve_capacity(std::max(want, grown_size()));
+				}
+				if(_size == 0){
+					Policy::on_reject_insert();
+					return 0;
+				}
+				size_type n = _size;
+				if(total > _size)
+					std::advance(first, total - _size);
+				else
+					n = static_cast<size_type>(total);
+				size_type overwritten = _end + n - _size;
+				if(overwritten < 0)
+					overwritten = 0;
+				destroy_front(overwritten);
+				size_type tail = physical(_end);
+				size_type run = std::min(n, _size - tail);
+				construct_run(tail, first, run);
+				construct_run(0, first, n - run);
+				Policy::on_insert_n(n - overwritten, overwritten, _end);
+				return n;
+			}
+	    }
+
+		/**
+		@brief Inserimento di un intervallo contiguo in coda al cbuffer
+
+		Equivalente a insert(values.begin(), values.end())
+		@param values Elementi da inserire
+		@return il numero di elementi scritti nel cbuffer
+		**/
+	    size_type insert(std::span<const T> values){
+			return insert(values.begin(), values.end());
+	    }
+
+		/**
+		@brief Rimozione degli n elementi più vecchi
+
+		Distrugge gli elementi in al più due tratti contigui e avanza la testa una sola volta
+		@param n Numero di elementi da rimuovere
+		@return il numero di elementi rimossi, minore di n se il cbuffer ne conteneva meno
+		**/
+	    size_type remove(size_type n){
+			if(empty()){
+				Policy::on_reject_remove();
+				return 0;
+			}
+			if(n > _end)
+				n = _end;
+			if(n <= 0)
+				return 0;
+			destroy_front(n);
+			Policy::on_remove_n(n, _end);
+			return n;
+	    }
+
+		/**
+		@brief Estrazione degli n elementi più vecchi
+
+		Sposta sull'iteratore di output out fino a n elementi, dal più vecchio, in al più
+		due tratti contigui (memcpy se T è banalmente copiabile e out è un iteratore contiguo),
+		poi li rimuove dal cbuffer
+		@param out Iteratore di output su cui scrivere gli elementi
+		@param n Numero massimo di elementi da estrarre
+		@return il numero di elementi estratti
+		**/
+		template <typename iteratorQ>
+	    size_type drain_into(iteratorQ out, size_type n){
+			if(empty()){
+				Policy::on_reject_remove();
+				return 0;
+			}
+			if(n > _end)
+				n = _end;
+			if(n <= 0)
+				return 0;
+			size_type run = std::min(n, _size - _start);
+			out = move_run(_buffer + _start, run, out);
+			move_run(_buffer, n - run, out);
+			destroy_front(n);
+			Policy::on_remove_n(n, _end);
+			return n;
+	    }
+
+		/**
+		@brief Consumo a blocchi degli n elementi più vecchi
+
+		Passa a callback gli elementi come std::span<T> in al più due tratti contigui
+		(prima e dopo il punto di wrap), senza controlli sugli indici, poi li rimuove
+		avanzando la testa una sola volta. Per elementi grandi il tratto successivo viene
+		richiesto in anticipo alla cache mentre callback elabora quello corrente.
+		callback può spostare gli elementi fuori dallo span; se genera un'eccezione
+		nessun elemento viene rimosso
+		@param n Numero massimo di elementi da consumare
+		@param callback Funzione chiamata con ogni tratto
+		@return il numero di elementi consumati
+		**/
+		template <typename Callback>
+	    size_type consume(size_type n, Callback callback){
+			if(empty()){
+				Policy::on_reject_remove();
+				return 0;
+			}
+			if(n > _end)
+				n = _end;
+			if(n <= 0)
+				return 0;
+			visit_runs(_buffer, _size, _start, n, n, callback);
+			destroy_front(n);
+			Policy::on_remove_n(n, _end);
+			return n;
+	    }
+
+		/**
+		@brief Visita a blocchi di tutti gli elementi
+
+		Passa a callback gli elementi dal più vecchio come std::span<T> contigui di al più
+		batch elementi, spezzati anche al punto di wrap, senza rimuoverli; con prefetch
+		del blocco successivo come consume
+		@param batch Numero massimo di elementi per blocco
+		@param callback Funzione chiamata con ogni blocco
+		@return il numero di blocchi visitati
+		@throw std::invalid_argument se batch non è positivo
+		**/
+		template <typename Callback>
+	    size_type for_each_batch(size_type batch, Callback callback){
+			if(batch <= 0)
+				throw std::invalid_argument("cbuffer batch must be positive");
+			return visit_runs(_buffer, _size, _start, _end, batch, callback);
+	    }
+
+		/**
+		@brief Visita a blocchi in sola lettura, con std::span<const T>
 		**/
-	    void remove(){
-			if(!empty()){
-	        	shift_left();
-	        	_end--;
-            	std::cout << "Removed first element, end:" << _end << std::endl;
-			}else
-				std::cout << "The cbuffer is already empty or the size is 0"
-							<< std::endl;
+		template <typename Callback>
+	    size_type for_each_batch(size_type batch, Callback callback) const {
+			if(batch <= 0)
+				throw std::invalid_argument("cbuffer batch must be positive");
+			return visit_runs(static_cast<const T *>(_buffer), _size, _start, _end, batch, callback);
 	    }
 
 		/**
@@ -252,7 +877,7 @@ class cbuffer{
 	    T &operator[](size_type index) {
 	        if(index >= _end)
 	            throw std::out_of_range("Index out of range");
-	        return _buffer[index];
+	        return _buffer[physical(index)];
 	    }
 			
 		/**
@@ -271,8 +896,59 @@ class cbuffer{
 	        if(index >= _end)
 	            throw std::out_of_range("Index out of range");
 	        else
-	            return _buffer[index];
+	            return _buffer[physical(index)];
         }
+
+		/**
+		@brief Accesso senza controllo dell'indice
+
+		Come operator[] ma senza eccezioni, per i cicli in cui l'indice è già noto valido
+		@pre 0 <= index < numero di elementi
+		@param index Indice logico, 0 è l'elemento più vecchio
+		@return Elemento in posizione index-esima
+		**/
+	    T &at_unchecked(size_type index) noexcept {
+	        return _buffer[physical(index)];
+	    }
+
+		/**
+		@brief Accesso senza controllo dell'indice in sola lettura
+		**/
+	    const T &at_unchecked(size_type index) const noexcept {
+	        return _buffer[physical(index)];
+	    }
+
+		/**
+		@brief Elemento più vecchio, senza controlli
+		@pre il cbuffer non è vuoto
+		**/
+	    T &front() noexcept {
+	        return _buffer[_start];
+	    }
+
+		/**
+		@brief Elemento più vecchio in sola lettura, senza controlli
+		@pre il cbuffer non è vuoto
+		**/
+	    const T &front() const noexcept {
+	        return _buffer[_start];
+	    }
+
+		/**
+		@brief Elemento più recente, senza controlli
+		@pre il cbuffer non è vuoto
+		**/
+	    T &back() noexcept {
+	        return _buffer[physical(_end - 1)];
+	    }
+
+		/**
+		@brief Elemento più recente in sola lettura, senza controlli
+		@pre il cbuffer non è vuoto
+		**/
+	    const T &back() const noexcept {
+	        return _buffer[physical(_end - 1)];
+	    }
 	
 		/**
 		@brief Controllo se il cbuffer è pieno
@@ -282,189 +958,163 @@ class cbuffer{
 		se la dimensione è 0 non viene considerato pieno,
 		@return true se è pieno, false se non lo è
 		**/
-	    bool full(){
+	    bool full() const {
 	        return _end >= _size && _size > 0;
 	    }
 
-	//iteratori ad accesso casuale
-    class const_iterator; // forward declaration
+		/**
+		@brief Primo tratto contiguo del contenuto
 
-	class iterator {
-		T *_it;
+		Ritorna gli elementi dal più vecchio fino alla fine dell'array o all'ultimo elemento;
+		insieme ad array_two copre tutto il contenuto in ordine logico senza copie,
+		ad esempio per costruire gli iovec di writev
+		@return span sugli elementi del primo tratto, vuoto se il cbuffer è vuoto
+		**/
+	    std::span<T> array_one() {
+	        return std::span<T>(_buffer + _start, std::min(_end, _size - _start));
+	    }
 
-	public:
-		typedef std::random_access_iterator_tag iterator_category;
-		typedef T                        value_type;
-		typedef ptrdiff_t                difference_type;//
-		typedef T*                       pointer;
-		typedef T&                       reference;
+		/**
+		@brief Primo tratto contiguo del contenuto in sola lettura
+		**/
+	    std::span<const T> array_one() const {
+	        return std::span<const T>(_buffer + _start, std::min(_end, _size - _start));
+	    }
 
-		iterator(): _it(0){
+		/**
+		@brief Secondo tratto contiguo del contenuto
 
-		}
+		Ritorna gli elementi che dopo il wrap si trovano all'inizio dell'array
+		@return span sugli elementi del secondo tratto, vuoto se il contenuto non attraversa il wrap
+		**/
+	    std::span<T> array_two() {
+	        return std::span<T>(_buffer, _end - std::min(_end, _size - _start));
+	    }
 
-		iterator(const iterator &other): _it(0) {
-			_it = other._it;
-		}
+		/**
+		@brief Secondo tratto contiguo del contenuto in sola lettura
+		**/
+	    std::span<const T> array_two() const {
+	        return std::span<const T>(_buffer, _end - std::min(_end, _size - _start));
+	    }
 
-		iterator& operator=(const iterator &other) {
-			_it = other._it;
-		}
+		/**
+		@brief Prenotazione di slot liberi in coda
+
+		Ritorna la memoria contigua di al più n slot liberi a partire dalla coda, che il
+		produttore può riempire direttamente (ad esempio con read o memcpy) e rendere visibili
+		con commit. Lo span può essere più corto di n se lo spazio libero attraversa il wrap
+		o è insufficiente: in quel caso si chiama di nuovo reserve dopo commit.
+		Gli slot non contengono oggetti costruiti, per questo T deve essere banalmente copiabile
+		@param n Numero di slot desiderati
+		@return span sugli slot prenotati, vuoto se il cbuffer è pieno
+		**/
+	    std::span<T> reserve(size_type n) requires std::is_trivially_copyable_v<T> {
+	        if(_size == 0 || n <= 0)
+	            return std::span<T>();
+	        size_type tail = _end < _size ? physical(_end) : 0;
+	        size_type contiguous = _end < _size ? std::min(_size - _end, _size - tail) : 0;
+	        return std::span<T>(_buffer + tail, std::min(n, contiguous));
+	    }
 
-		~iterator(){
-		    _it = 0;
-		}
+		/**
+		@brief Pubblicazione degli slot prenotati
 
-		// Ritorna il dato riferito dall'iteratore (dereferenziamento)
-		reference operator*() const {
-            return *_it;
-		}
+		Aggiunge in coda i primi n slot restituiti dall'ultima reserve
+		@pre n non supera la lunghezza dello span restituito da reserve
+		@param n Numero di slot effettivamente scritti
+		**/
+	    void commit(size_type n) requires std::is_trivially_copyable_v<T> {
+	        if(n <= 0)
+	            return;
+	        _end += n;
+	        Policy::on_insert_n(n, 0, _end);
+	    }
 
-		// Ritorna il puntatore al dato riferito dall'iteratore
-		pointer operator->() const {
-			return _it;
-		}
+	//iteratori ad accesso casuale
+	//Gli iteratori mantengono la posizione "srotolata" _pos = _start + indice logico,
+	//compresa in [0, 2 * _size), e la riportano nell'array solo al dereferenziamento
+	/**
+	@brief Iteratore ad accesso casuale in ordine logico, dal più vecchio al più recente
 
-		// Operatore di accesso random
-		reference operator[](int index) {
-            return _it[index];
-		}
+	Attraversa il punto di wrap senza modulo: la posizione srotolata viene riportata
+	nell'array con un solo confronto. Soddisfa std::random_access_iterator; come
+	iteratore segmentato espone segment(), il tratto contiguo fino al wrap o a last,
+	usato da for_each_segment e dagli algoritmi di cbuffer_algo.hpp per spezzare
+	un intervallo in al più due cicli su memoria contigua
+	**/
+	template <bool Const>
+	class basic_iterator {
+		typedef typename std::conditional<Const, const T, T>::type element_type;
 
-		// Operatore di iterazione post-incremento
-		iterator operator++(int) {
-			iterator tmp(*this);
-            _it++;
-			return tmp;
-		}
+		element_type *_base;
+		size_type _cap;
+		ptrdiff_t _pos;
 
-		// Operatore di iterazione pre-incremento
-		iterator &operator++() {
-			++_it;
-			return *this;
-		}
+		friend class cbuffer;
+		friend class basic_iterator<!Const>;
 
-		// Operatore di iterazione post-decremento
-		iterator operator--(int) {
-			iterator tmp(*this);
-			_it--;
-			return tmp;
-		}
+		basic_iterator(element_type *base, size_type cap, ptrdiff_t pos): _base(base), _cap(cap), _pos(pos) {}
 
-		// Operatore di iterazione pre-decremento
-		iterator &operator--() {
-			--_it;
-			return *this;
+		element_type *ptr(ptrdiff_t pos) const {
+			return _base + (pos < _cap ? pos : pos - _cap);
 		}
 
-		// Spostamentio in avanti della posizione
-		iterator operator+(int offset) {
-			_it += offset;
-			return *this;
-		}
+	public:
+		typedef std::random_access_iterator_tag iterator_concept;
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef ptrdiff_t difference_type;
+		typedef element_type *pointer;
+		typedef element_type &reference;
 
-		// Spostamentio all'indietro della posizione
-		iterator operator-(int offset) {
-			_it  -= offset;
-			return *this;
-		}
+		basic_iterator(): _base(0), _cap(0), _pos(0) {}
 
-		// Spostamentio in avanti della posizione
-		iterator& operator+=(int offset) {
-			_it += offset;
-			return *this;
-		}
+		// Conversione iterator -> const_iterator
+		template <bool C = Const, typename = typename std::enable_if<C>::type>
+		basic_iterator(const basic_iterator<false> &other): _base(other._base), _cap(other._cap), _pos(other._pos) {}
 
-		// Spostamentio all'indietro della posizione
-		iterator& operator-=(int offset) {
-			_it -= offset;
-			return *this;
-		}
+		reference operator*() const { return *ptr(_pos); }
+		pointer operator->() const { return ptr(_pos); }
+		reference operator[](difference_type n) const { return *ptr(_pos + n); }
 
-		// Numero di elementi tra due iteratori
-		difference_type operator-(const iterator &other) {
-			difference_type diff = _it - other._it;
-			if(diff < 0)
-			    diff *= -1;
-			return diff;
-		}
+		basic_iterator &operator++() { ++_pos; return *this; }
+		basic_iterator operator++(int) { basic_iterator tmp(*this); ++_pos; return tmp; }
+		basic_iterator &operator--() { --_pos; return *this; }
+		basic_iterator operator--(int) { basic_iterator tmp(*this); --_pos; return tmp; }
+		basic_iterator &operator+=(difference_type n) { _pos += n; return *this; }
+		basic_iterator &operator-=(difference_type n) { _pos -= n; return *this; }
+		basic_iterator operator+(difference_type n) const { return basic_iterator(_base, _cap, _pos + n); }
+		basic_iterator operator-(difference_type n) const { return basic_iterator(_base, _cap, _pos - n); }
+		friend basic_iterator operator+(difference_type n, const basic_iterator &it) { return it + n; }
 
-		// Uguaglianza
-		bool operator==(const iterator &other) const {
-			return _it == other._it;
-		}
+		// Distanza con segno: positiva se *this segue other
+		template <bool C>
+		difference_type operator-(const basic_iterator<C> &other) const { return _pos - other._pos; }
 
-		// Diversita'
-		bool operator!=(const iterator &other) const {
-			return _it != other._it;
-		}
-
-		// Confronto
-		bool operator>(const iterator &other) const {
-			return _it > other._it;
-		}
+		template <bool C>
+		bool operator==(const basic_iterator<C> &other) const { return _pos == other._pos; }
 
+		template <bool C>
+		std::strong_ordering operator<=>(const basic_iterator<C> &other) const { return _pos <=> other._pos; }
 
-		bool operator>=(const iterator &other) const {
-			return _it >= other._it;
-		}
-
-		// Confronto
-		bool operator<(const iterator &other) const {
-			return _it < other._it;
-		}
-
-
-		// Confronto
-		bool operator<=(const iterator &other) const {
-			return _it <= other._it;
-		}
-
-
-		// Solo se serve anche const_iterator aggiungere le seguenti definizioni
-
-	friend class const_iterator;
-
-		// Uguaglianza
-		bool operator==(const const_iterator &other) const {
-			return _it == other._it;
-		}
-
-		// Diversita'
-		bool operator!=(const const_iterator &other) const {
-			return _it != other._it;
-		}
-
-		// Confronto
-		bool operator>(const const_iterator &other) const {
-			return _it > other._it;
-		}
-
-
-		bool operator>=(const const_iterator &other) const {
-			return _it >= other._it;
-		}
-
-		// Confronto
-		bool operator<(const const_iterator &other) const {
-			return _it < other._it;
-		}
-
-
-		// Confronto
-		bool operator<=(const const_iterator &other) const {
-			return _it <= other._it;
-		}
-
-		// Solo se serve anche const_iterator aggiungere le precedenti definizioni
-
-	private:
-		friend class cbuffer;
+		/**
+		@brief Tratto contiguo da *this verso last
 
-	    iterator(T* it){
-		    _it = it;
+		@pre *this <= last, entrambi dello stesso cbuffer
+		@param last Fine dell'intervallo
+		@return span dagli elementi di *this fino a last o al punto di wrap, il primo che viene
+		**/
+		std::span<element_type> segment(const basic_iterator &last) const {
+			ptrdiff_t stop = _pos < _cap ? std::min<ptrdiff_t>(last._pos, _cap) : last._pos;
+			return std::span<element_type>(ptr(_pos), static_cast<std::size_t>(stop - _pos));
 		}
+	};
 
-	}; // classe iterator
+	typedef basic_iterator<false> iterator; ///< Iteratore in ordine logico
+	typedef basic_iterator<true> const_iterator; ///< Iteratore costante in ordine logico
+	typedef std::reverse_iterator<iterator> reverse_iterator; ///< Iteratore dal più recente al più vecchio
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator; ///< Iteratore costante dal più recente al più vecchio
 
 	/**
 	@brief Iteratore di inizio della sequenza
@@ -473,7 +1123,7 @@ class cbuffer{
 	@return Ritorna l'iteratore all'inizio della sequenza di dati
 	**/
 	iterator begin() {
-		return iterator(_buffer);
+		return iterator(_buffer, _size, _start);
 	}
 
 	/**
@@ -483,231 +1133,437 @@ class cbuffer{
 	@return Ritorna l'iteratore alla fine della sequenza di dati
 	**/
 	iterator end() {
-		return iterator(_buffer + _end);
+		return iterator(_buffer, _size, _start + _end);
 	}
 
-	class const_iterator {
-
-	    T *_it;
-
-	public:
-		typedef std::random_access_iterator_tag iterator_category;
-		typedef T                        value_type;
-		typedef ptrdiff_t                difference_type;
-		typedef const T*                 pointer;
-		typedef const T&                 reference;
-
-
-		const_iterator() {
-			_it = 0;
-		}
-
-		const_iterator(const const_iterator &other) {
-			_it = other._it;
-		}
+	/**
+	@brief Iteratore di inizio della sequenza
 
-		const_iterator& operator=(const const_iterator &other) {
-			_it = other._it;
-		}
+	Ritorna l'iteratore all'inizio della sequenza di dati contenuti nel cbuffer
+	@return Ritorna l'iteratore all'inizio della sequenza di dati
+	**/
+	const_iterator begin() const {
+		return const_iterator(_buffer, _size, _start);
+	}
 
-		~const_iterator() {
-			_it = 0;
-		}
+	/**
+	@brief Iteratore di fine della sequenza
 
-		// Ritorna il dato riferito dall'iteratore (dereferenziamento)
-		reference operator*() const {
-			return *_it;
-		}
+	Ritorna l'iteratore alla fine della sequenza di dati contenuti nel cbuffer
+	@return Ritorna l'iteratore alla fine della sequenza di dati
+	**/
+	const_iterator end() const {
+		return const_iterator(_buffer, _size, _start + _end);
+	}
 
-		// Ritorna il puntatore al dato riferito dall'iteratore
-		pointer operator->() const {
-			return _it;
-		}
+	const_iterator cbegin() const {
+		return begin();
+	}
 
-		// Operatore di accesso random
-		reference operator[](int index) {
-			return _it[index];
-		}
+	const_iterator cend() const {
+		return end();
+	}
 
-		// Operatore di iterazione post-incremento
-		const_iterator operator++(int) {
-			const_iterator tmp(*this);
-			_it++;
-			return tmp;
-		}
+	/**
+	@brief Iteratore inverso sull'elemento più recente
+	**/
+	reverse_iterator rbegin() {
+		return reverse_iterator(end());
+	}
 
-		// Operatore di iterazione pre-incremento
-		const_iterator &operator++() {
-			++_it;
-			return *this;
-		}
+	/**
+	@brief Iteratore inverso di fine, prima dell'elemento più vecchio
+	**/
+	reverse_iterator rend() {
+		return reverse_iterator(begin());
+	}
 
-		// Operatore di iterazione post-decremento
-		const_iterator operator--(int) {
-			const_iterator tmp(*this);
-			_it--;
-			return tmp;
-		}
+	const_reverse_iterator rbegin() const {
+		return const_reverse_iterator(end());
+	}
 
-		// Operatore di iterazione pre-decremento
-		const_iterator &operator--() {
-			--_it;
-			return *this;
-		}
+	const_reverse_iterator rend() const {
+		return const_reverse_iterator(begin());
+	}
 
-		// Spostamentio in avanti della posizione
-		const_iterator operator+(int offset) {
-			_it += offset;
-			return *this;
-		}
+	const_reverse_iterator crbegin() const {
+		return rbegin();
+	}
 
-		// Spostamentio all'indietro della posizione
-		const_iterator operator-(int offset) {
-			_it -= offset;
-			return *this;
-		}
+	const_reverse_iterator crend() const {
+		return rend();
+	}
 
-		// Spostamentio in avanti della posizione
-		const_iterator& operator+=(int offset) {
-			_it += offset;
-			return *this;
-		}
+    private:
+		void clear(){
+            for(size_type i = 0; i < _end; ++i)
+                alloc_traits::destroy(_alloc, _buffer + physical(i));
+            deallocate(_buffer, _size);
+	        _buffer = 0;
+	        _size = 0;
+	        _end = 0;
+	        _start = 0;
+        }
 
-		// Spostamentio all'indietro della posizione
-		const_iterator& operator-=(int offset) {
-			_it -= offset;
-			return *this;
-		}
+        /**
+        @brief Allocazione della memoria per n elementi
+
+        Alloca memoria grezza per n elementi tramite l'allocatore senza costruire alcun elemento
+        @return puntatore alla memoria, 0 se n <= 0
+        **/
+        T *allocate(size_type n){
+            if(n <= 0)
+                return 0;
+            return alloc_traits::allocate(_alloc, n);
+        }
 
-		// Numero di elementi tra due iteratori
-		difference_type operator-(const const_iterator &other) {
-		    difference_type diff = _it - other._it;
-			if(diff < 0)
-			    diff *= -1;
-			return diff;
-		}
+        /**
+        @brief Rilascio della memoria ottenuta con allocate
+
+        Gli elementi devono essere già stati distrutti
+        @param p Memoria da rilasciare
+        @param n Numero di elementi per cui era stata allocata
+        **/
+        void deallocate(T *p, size_type n){
+            if(p)
+                alloc_traits::deallocate(_alloc, p, n);
+        }
 
-		// Uguaglianza
-		bool operator==(const const_iterator &other) const {
-			return _it == other._it;
-		}
+        /**
+        @brief Copia degli elementi di other
 
-		// Diversita'
-		bool operator!=(const const_iterator &other) const {
-			return _it != other._it;
-		}
+        Alloca un array della stessa dimensione di other e vi copia gli elementi in ordine logico,
+        this deve essere vuoto e senza array
+        **/
+        void copy_from(const cbuffer &other){
+            _buffer = allocate(other._size);
+            _size = other._size;
+            try {
+                unwrap_into<false>(_buffer, other._buffer, other._size, other._start, other._end);
+            }
+            catch(...) {
+                clear();
+                throw;
+            }
+            _end = other._end;
+        }
 
-		// Confronto
-		bool operator>(const const_iterator &other) const {
-			return _it > other._it;
-		}
+        /**
+        @brief Spostamento degli elementi di other
 
+        Come copy_from ma sposta gli elementi, usato quando gli allocatori sono diversi
+        **/
+        void move_from(cbuffer &other){
+            _buffer = allocate(other._size);
+            _size = other._size;
+            try {
+                unwrap_into<true>(_buffer, other._buffer, other._size, other._start, other._end);
+            }
+            catch(...) {
+                clear();
+                throw;
+            }
+            _end = other._end;
+        }
 
-		bool operator>=(const const_iterator &other) const {
-			return _it >= other._it;
-		}
+        /**
+        @brief Copia o spostamento di n elementi di un ring in memoria non inizializzata
+
+        Porta in dst, in ordine, gli n elementi di src (array di src_size slot) a partire
+        dalla posizione fisica pos, in al più due tratti contigui: memcpy se _memcpy_ok,
+        altrimenti costruzione con l'allocatore. In caso di eccezione gli elementi già
+        costruiti in dst vengono distrutti
+        **/
+        template <bool Move>
+        void unwrap_into(T *dst, T *src, size_type src_size, size_type pos, size_type n){
+            if(n <= 0)
+                return;
+            size_type run = std::min(n, src_size - pos);
+            if constexpr(_memcpy_ok){
+                std::memcpy(static_cast<void *>(dst), src + pos, sizeof(T) * run);
+                std::memcpy(static_cast<void *>(dst + run), src, sizeof(T) * (n - run));
+            }else{
+                size_type i = 0;
+                try{
+                    for(; i < n; ++i){
+                        T &element = i < run ? src[pos + i] : src[i - run];
+                        if constexpr(Move)
+                            alloc_traits::construct(_alloc, dst + i, std::move(element));
+                        else
+                            alloc_traits::construct(_alloc, dst + i, static_cast<const T &>(element));
+                    }
+                }catch(...){
+                    for(size_type j = 0; j < i; ++j)
+                        alloc_traits::destroy(_alloc, dst + j);
+                    throw;
+                }
+            }
+        }
 
-		// Confronto
-		bool operator<(const const_iterator &other) const {
-			return _it < other._it;
-		}
+        /**
+        @brief Porta n elementi di this, dalla posizione fisica pos, in dst
+
+        Sposta se non può lanciare eccezioni, altrimenti copia, così che this resti intatto
+        se la costruzione fallisce
+        **/
+        void relocate_into(T *dst, size_type pos, size_type n){
+            unwrap_into<std::is_nothrow_move_constructible<T>::value || !std::is_copy_constructible<T>::value>(
+                dst, _buffer, _size, pos, n);
+        }
 
+        /**
+        @brief Sostituisce l'array con buffer, che contiene count elementi dalla posizione 0
+
+        Gli elementi dell'array corrente vengono distrutti
+        **/
+        void replace_array(T *buffer, size_type n, size_type count){
+            destroy_front(_end);
+            deallocate(_buffer, _size);
+            _buffer = buffer;
+            _size = n;
+            _start = 0;
+            _end = count;
+        }
 
-		// Confronto
-		bool operator<=(const const_iterator &other) const {
-			return _it <= other._it;
-		}
+        /// Posizione fisica dell'elemento logico index, anche se index == _size
+        size_type physical_of(size_type index) const {
+            return _size == 0 ? 0 : physical(index % _size);
+        }
 
-		// Solo se serve anche iterator aggiungere le seguenti definizioni
+        /// true se un inserimento a cbuffer pieno deve far crescere l'array
+        bool can_grow() const {
+            return _size < _grow_limit;
+        }
 
-		friend class iterator;
+        /// Dimensione dopo una crescita automatica
+        size_type grown_size() const {
+            double grown = static_cast<double>(_size) * _growth;
+            if(grown >= static_cast<double>(_grow_limit))
+                return _grow_limit;
+            return std::max(_size + 1, static_cast<size_type>(grown));
+        }
 
-		// Uguaglianza
-		bool operator==(const iterator &other) const {
-			return _it == other._it;
-		}
+        /**
+        @brief Crescita dell'array con inserimento in coda
+
+        Il nuovo elemento è costruito nel nuovo array prima di spostare gli altri,
+        quindi args può riferirsi a un elemento del cbuffer
+        **/
+        template <typename... Args>
+        void grow_emplace(Args&&... args){
+            size_type n = grown_size();
+            T *buffer = allocate(n);
+            try{
+                alloc_traits::construct(_alloc, buffer + _end, std::forward<Args>(args)...);
+            }catch(...){
+                deallocate(buffer, n);
+                throw;
+            }
+            try{
+                relocate_into(buffer, _start, _end);
+            }catch(...){
+                alloc_traits::destroy(_alloc, buffer + _end);
+                deallocate(buffer, n);
+                throw;
+            }
+            replace_array(buffer, n, _end + 1);
+            Policy::on_insert(_buffer[_end - 1], _end);
+        }
 
-		// Diversita'
-		bool operator!=(const iterator &other) const {
-			return _it != other._it;
-		}
+        /**
+        @brief Swap completo, allocatore compreso
+
+        Usato dagli assegnamenti, dove other è stato creato con l'allocatore che this deve adottare:
+        se l'allocatore non si propaga other ne ha una copia uguale e non serve scambiarlo
+        **/
+        void swap_all(cbuffer &other) noexcept {
+            swap(other);
+            if constexpr(!alloc_traits::propagate_on_container_swap::value &&
+                         (alloc_traits::propagate_on_container_copy_assignment::value ||
+                          alloc_traits::propagate_on_container_move_assignment::value)){
+                using std::swap;
+                swap(other._alloc, _alloc);
+            }
+        }
 
-		// Confronto
-		bool operator>(const iterator &other) const {
-			return _it > other._it;
-		}
+        /**
+        @brief true se costruire un T con l'allocatore equivale a copiarne i byte
 
+        Vale per T banalmente copiabile con std::allocator o polymorphic_allocator,
+        che non personalizzano la costruzione di questi tipi
+        **/
+        static constexpr bool _memcpy_ok = std::is_trivially_copyable<T>::value &&
+            (std::is_same<Allocator, std::allocator<T> >::value ||
+             std::is_same<Allocator, std::pmr::polymorphic_allocator<T> >::value);
 
-		bool operator>=(const iterator &other) const {
-			return _it >= other._it;
-		}
+        /**
+        @brief Costruzione di n elementi consecutivi in coda
 
-		// Confronto
-		bool operator<(const iterator &other) const {
-			return _it < other._it;
-		}
+        Costruisce n elementi a partire dalla posizione fisica pos copiandoli da src,
+        che viene avanzato; _end è aggiornato elemento per elemento così che in caso
+        di eccezione il cbuffer resti consistente
+        **/
+        template <typename iteratorQ>
+        void construct_run(size_type pos, iteratorQ &src, size_type n){
+            if(n <= 0)
+                return;
+            if constexpr(_memcpy_ok && cbuffer_contiguous_iterator<iteratorQ, T>){
+                std::memcpy(static_cast<void *>(_buffer + pos), std::to_address(src), sizeof(T) * n);
+                src += n;
+                _end += n;
+            }else{
+                for(size_type i = 0; i < n; ++i, ++src, ++_end)
+                    alloc_traits::construct(_alloc, _buffer + pos + i, *src);
+            }
+        }
 
+        /**
+        @brief Spostamento di n elementi consecutivi su out
 
-		// Confronto
-		bool operator<=(const iterator &other) const {
-			return _it <= other._it;
-		}
+        @return l'iteratore di output avanzato
+        **/
+        template <typename iteratorQ>
+        static iteratorQ move_run(T *src, size_type n, iteratorQ out){
+            if(n <= 0)
+                return out;
+            if constexpr(std::is_trivially_copyable<T>::value && cbuffer_contiguous_iterator<iteratorQ, T>){
+                std::memcpy(static_cast<void *>(std::to_address(out)), src, sizeof(T) * n);
+                return out + n;
+            }else
+                return std::move(src, src + n, out);
+        }
 
-		// Costruttore di conversione iterator -> const_iterator
-		const_iterator(const iterator &other) {
-			_it = other._it;
-		}
+        /**
+        @brief Distruzione degli n elementi più vecchi
+
+        Distrugge gli elementi in al più due tratti contigui (nessun ciclo se T è
+        banalmente distruttibile) e avanza la testa; se il cbuffer si svuota la testa
+        torna a 0 così che i prossimi inserimenti siano contigui
+        **/
+        void destroy_front(size_type n){
+            if(n <= 0)
+                return;
+            if constexpr(!std::is_trivially_destructible<T>::value){
+                size_type run = std::min(n, _size - _start);
+                for(size_type i = 0; i < run; ++i)
+                    alloc_traits::destroy(_alloc, _buffer + _start + i);
+                for(size_type i = 0; i < n - run; ++i)
+                    alloc_traits::destroy(_alloc, _buffer + i);
+            }
+            _end -= n;
+            _start = _end == 0 ? 0 : physical(n);
+        }
 
-		// Assegnamento di un iterator ad un const_iterator
-		const_iterator &operator=(const iterator &other) {
-			_it = other._it;
-		}
+        /**
+        @brief Controllo se la sequenza di total elementi da first si trova in questo cbuffer
 
-		// Solo se serve anche iterator aggiungere le precedenti definizioni
+        Riconosce gli iteratori del cbuffer, i puntatori e gli iteratori contigui su T,
+        anche dentro std::reverse_iterator e std::move_iterator
+        **/
+        template <typename iteratorQ>
+        bool aliases(iteratorQ first, std::ptrdiff_t total) const {
+            if constexpr(std::is_same_v<iteratorQ, iterator> || std::is_same_v<iteratorQ, const_iterator>)
+                return _buffer != 0 && first._base == _buffer;
+            else if constexpr(cbuffer_adaptor<iteratorQ>::reverse)
+                return aliases(std::prev(first.base(), total), total);
+            else if constexpr(cbuffer_adaptor<iteratorQ>::move)
+                return aliases(first.base(), total);
+            else if constexpr(std::contiguous_iterator<iteratorQ> &&
+                    std::is_same_v<std::iter_value_t<iteratorQ>, T>){
+                const T *p = std::to_address(first);
+                std::less<const T *> less;
+                return _size > 0 && less(p, _buffer + _size) && less(static_cast<const T *>(_buffer), p + total);
+            }else
+                return false;
+        }
 
-	private:
-		friend class cbuffer;
+        /**
+        @brief Prefetch delle prime CBUFFER_PREFETCH_BYTES di [p, p + n)
+
+        Solo per elementi grandi almeno una linea di cache: per quelli piccoli basta il
+        prefetch hardware sugli accessi sequenziali
+        **/
+        static void prefetch_run(const T *p, size_type n){
+#if defined(__GNUC__)
+            if constexpr(sizeof(T) >= CBUFFER_CACHE_LINE && CBUFFER_PREFETCH_BYTES > 0){
+                const char *bytes = reinterpret_cast<const char *>(p);
+                std::size_t len = std::min<std::size_t>(static_cast<std::size_t>(n) * sizeof(T), CBUFFER_PREFETCH_BYTES);
+                for(std::size_t off = 0; off < len; off += CBUFFER_CACHE_LINE)
+                    __builtin_prefetch(bytes + off, 0, 3);
+            }
+#else
+            (void)p;
+            (void)n;
+#endif
+        }
 
-	    const_iterator(T* it){
-		    _it = it;
-		}
+        /**
+        @brief Visita degli n elementi a partire da start in tratti contigui di al più batch
+
+        Il tratto successivo viene richiesto alla cache prima di passare a callback quello corrente
+        @return il numero di tratti visitati
+        **/
+        template <typename U, typename Callback>
+        static size_type visit_runs(U *buffer, size_type size, size_type start, size_type n, size_type batch, Callback &callback){
+            size_type runs = 0;
+            size_type pos = start;
+            size_type len = std::min(n, std::min(batch, size - pos));
+            prefetch_run(buffer + pos, len);
+            while(n > 0){
+                U *run = buffer + pos;
+                n -= len;
+                pos += len;
+                if(pos == size)
+                    pos = 0;
+                size_type next_len = std::min(n, std::min(batch, size - pos));
+                if(next_len > 0)
+                    prefetch_run(buffer + pos, next_len);
+                callback(std::span<U>(run, len));
+                len = next_len;
+                ++runs;
+            }
+            return runs;
+        }
 
-	}; // classe const_iterator
+        /**
+        @brief Indice fisico di un elemento
+
+        Converte l'indice logico index (0 = elemento più vecchio) nella posizione
+        dell'array, senza usare l'operatore modulo
+        @pre 0 <= index < _size
+        **/
+        size_type physical(size_type index) const {
+            size_type pos = _start + index;
+            return pos < _size ? pos : pos - _size;
+        }
 
-	/**
-	@brief Iteratore di inizio della sequenza
+        /**
+        @brief Indice fisico successivo
 
-	Ritorna l'iteratore all'inizio della sequenza di dati contenuti nel cbuffer
-	@return Ritorna l'iteratore all'inizio della sequenza di dati
-	**/
-	const_iterator begin() const {
-		return const_iterator(_buffer);
-	}
+        Ritorna la posizione dell'array che segue pos, tornando a 0 dopo l'ultima
+        **/
+        size_type next(size_type pos) const {
+            return ++pos == _size ? 0 : pos;
+        }
+};
 
-	/**
-	@brief Iteratore di fine della sequenza
+/**
+@brief cbuffer che alloca da una std::pmr::memory_resource
 
-	Ritorna l'iteratore alla fine della sequenza di dati contenuti nel cbuffer
-	@return Ritorna l'iteratore alla fine della sequenza di dati
-	**/
-	const_iterator end() const {
-		return const_iterator(_buffer + _end);
-	}
+Ad esempio pmr_cbuffer<voce> cb(100, &arena) con arena di tipo cbuffer_arena
+**/
+template <typename T, typename Policy = cbuffer_null_policy>
+using pmr_cbuffer = cbuffer<T, Policy, std::pmr::polymorphic_allocator<T> >;
 
-    private:
-		void clear(){
-            delete[] _buffer;
-	        //_start = -1;
-	        _buffer = 0;
-	        _size = 0;
-	        _end = 0;
-        }
+/**
+@brief Swap tra due cbuffer
 
-        void shift_left(){
-            for(size_type i = 1; i < _size; ++i)
-                _buffer[i - 1] = _buffer[i];
-        }
-};
+Versione non membro di cbuffer::swap, trovata tramite ADL dagli algoritmi standard
+**/
+template<typename T, typename Policy, typename Allocator>
+void swap(cbuffer<T, Policy, Allocator> &a, cbuffer<T, Policy, Allocator> &b) noexcept {
+    a.swap(b);
+}
 
 /**
 @brief Funzione su predicato unario
@@ -715,10 +1571,10 @@ class cbuffer{
 La funzione stampa sullo standard input per l'elemento i-esimo del cbuffer true se il predicato con l'elemento i-esimo e vero,
 altrimenti false
 **/
-template<typename P,  typename T>//type of the predicate
-void evaluate_if(const cbuffer<T> &cb, P pred){
-    typename cbuffer<T>::const_iterator begin = cb.begin();
-    typename cbuffer<T>::const_iterator end = cb.end();
+template<typename P,  typename T, typename Policy, typename Allocator>//type of the predicate
+void evaluate_if(const cbuffer<T, Policy, Allocator> &cb, P pred){
+    typename cbuffer<T, Policy, Allocator>::const_iterator begin = cb.begin();
+    typename cbuffer<T, Policy, Allocator>::const_iterator end = cb.end();
     int i;
     for(i = 0; begin != end; ++begin)
         std::cout << "[" << i++ << "]: " << pred(*begin) << std::endl;
@@ -735,9 +1591,9 @@ void evaluate_if(const cbuffer<T> &cb, P pred){
 	@return Il riferimento allo stream di output
 **/
 
-template<typename T>
-std::ostream &operator<<(std::ostream &os, const cbuffer<T> &cb){
-    typename cbuffer<T>::const_iterator sit, eit;
+template<typename T, typename Policy, typename Allocator>
+std::ostream &operator<<(std::ostream &os, const cbuffer<T, Policy, Allocator> &cb){
+    typename cbuffer<T, Policy, Allocator>::const_iterator sit, eit;
     sit = cb.begin();
     eit = cb.end();
     if(sit == eit){
@@ -749,4 +1605,413 @@ std::ostream &operator<<(std::ostream &os, const cbuffer<T> &cb){
     return os;
 }
 
+/**
+@brief Buffer circolare lock-free single-producer/single-consumer
+
+Variante di cbuffer pensata per un solo thread produttore e un solo thread consumatore
+che operano in parallelo senza mutex. Gli indici di testa (lettura) e di coda (scrittura)
+sono contatori atomici su linee di cache separate: il produttore pubblica i dati con una
+store release sulla coda e il consumatore li libera con una store release sulla testa.
+La capacità è una potenza di due, così la posizione nell'array si ottiene con una maschera.
+A differenza di cbuffer, quando il buffer è pieno l'inserimento fallisce invece di sovrascrivere.
+Gli slot sono allocati tutti alla costruzione, quindi T deve avere un costruttore di default
+e gli operatori di assegnamento per copia e per spostamento.
+**/
+template <typename T>
+class spsc_cbuffer{
+    public:
+        typedef T value_type; ///< Definzione del tipo corrispondente al valore contenuto del buffer
+        typedef std::size_t size_type; ///< Definzione del tipo corrispondente alla dimensione del buffer
+    private:
+        T *_buffer; ///< Puntatore all'array
+        size_type _size; ///< Dimensione dell'array, potenza di due
+        size_type _mask; ///< Maschera _size - 1 usata per riportare gli indici nell'array
+
+        alignas(CBUFFER_CACHE_LINE) std::atomic<size_type> _head; ///< Indice di lettura, scritto dal consumatore
+        size_type _tail_cache; ///< Ultimo valore di _tail letto dal consumatore
+
+        alignas(CBUFFER_CACHE_LINE) std::atomic<size_type> _tail; ///< Indice di scrittura, scritto dal produttore
+        size_type _head_cache; ///< Ultimo valore di _head letto dal produttore
+
+        spsc_cbuffer(const spsc_cbuffer &other) = delete;
+        spsc_cbuffer &operator=(const spsc_cbuffer &other) = delete;
+
+    public:
+        /**
+        @brief Costruttore con capacità
+
+        Crea il buffer con capacità pari alla più piccola potenza di due maggiore o uguale a size
+        (minimo 1)
+        @param size Numero minimo di elementi che il buffer deve poter contenere
+        **/
+        explicit spsc_cbuffer(size_type size): _buffer(0), _size(1), _mask(0),
+            _head(0), _tail_cache(0), _tail(0), _head_cache(0){
+            while(_size < size)
+                _size <<= 1;
+            _mask = _size - 1;
+            _buffer = new T[_size];
+        }
+
+        /**
+        @brief Distruttore
+
+        Libera l'array, nessun thread deve più usare il buffer
+        **/
+        ~spsc_cbuffer(){
+            delete[] _buffer;
+        }
+
+        /**
+        @brief Capacità del buffer
+
+        @return il numero massimo di elementi contenibili, sempre una potenza di due
+        **/
+        size_type size() const {
+            return _size;
+        }
+
+        /**
+        @brief Elementi presenti
+
+        Il valore è una fotografia: può essere già cambiato quando il chiamante lo usa
+        @return il numero di elementi presenti nel buffer
+        **/
+        size_type count() const {
+            return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+        }
+
+        /**
+        @brief Controllo se il buffer è vuoto (fotografia)
+        **/
+        bool empty() const {
+            return count() == 0;
+        }
+
+        /**
+        @brief Inserimento di un elemento (solo produttore)
+
+        Copia value in coda al buffer se c'è spazio
+        @param value Valore da inserire
+        @return true se l'elemento è stato inserito, false se il buffer è pieno
+        **/
+        bool try_push(const T &value){
+            const size_type tail = _tail.load(std::memory_order_relaxed);
+            if(tail - _head_cache == _size){
+                _head_cache = _head.load(std::memory_order_acquire);
+                if(tail - _head_cache == _size)
+                    return false;
+            }
+            _buffer[tail & _mask] = value;
+            _tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+        @brief Estrazione di un elemento (solo consumatore)
+
+        Sposta in value l'elemento più vecchio del buffer, se presente
+        @param value Destinazione dell'elemento estratto
+        @return true se un elemento è stato estratto, false se il buffer è vuoto
+        **/
+        bool try_pop(T &value){
+            const size_type head = _head.load(std::memory_order_relaxed);
+            if(head == _tail_cache){
+                _tail_cache = _tail.load(std::memory_order_acquire);
+                if(head == _tail_cache)
+                    return false;
+            }
+            value = std::move(_buffer[head & _mask]);
+            _head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+        @brief Inserimento di più elementi (solo produttore)
+
+        Copia fino a n elementi a partire da first, pubblicandoli tutti con una sola store
+        @param first Iteratore al primo elemento da inserire
+        @param n Numero di elementi disponibili a partire da first
+        @return il numero di elementi effettivamente inseriti (0 se il buffer è pieno)
+        **/
+        template <typename iteratorQ>
+        size_type try_push_bulk(iteratorQ first, size_type n){
+            const size_type tail = _tail.load(std::memory_order_relaxed);
+            size_type space = _size - (tail - _head_cache);
+            if(space < n){
+                _head_cache = _head.load(std::memory_order_acquire);
+                space = _size - (tail - _head_cache);
+            }
+            if(n > space)
+                n = space;
+            for(size_type i = 0; i < n; ++i, ++first)
+                _buffer[(tail + i) & _mask] = *first;
+            if(n > 0)
+                _tail.store(tail + n, std::memory_order_release);
+            return n;
+        }
+
+        /**
+        @brief Estrazione di più elementi (solo consumatore)
+
+        Sposta fino a n elementi sull'iteratore di output out, liberandoli tutti con una sola store
+        @param out Iteratore di output su cui scrivere gli elementi
+        @param n Numero massimo di elementi da estrarre
+        @return il numero di elementi effettivamente estratti (0 se il buffer è vuoto)
+        **/
+        template <typename iteratorQ>
+        size_type try_pop_bulk(iteratorQ out, size_type n){
+            const size_type head = _head.load(std::memory_order_relaxed);
+            size_type avail = _tail_cache - head;
+            if(avail < n){
+                _tail_cache = _tail.load(std::memory_order_acquire);
+                avail = _tail_cache - head;
+            }
+            if(n > avail)
+                n = avail;
+            for(size_type i = 0; i < n; ++i, ++out)
+                *out = std::move(_buffer[(head + i) & _mask]);
+            if(n > 0)
+                _head.store(head + n, std::memory_order_release);
+            return n;
+        }
+};
+
+/**
+@brief Politica di gestione del buffer pieno per mpmc_cbuffer
+
+- overflow_reject: l'inserimento fallisce e ritorna false
+- overflow_overwrite: viene scartato l'elemento più vecchio per fare spazio, come in cbuffer
+- overflow_spin: push attende (spin con yield) che un consumatore liberi uno slot
+**/
+enum overflow_policy {
+    overflow_reject,
+    overflow_overwrite,
+    overflow_spin
+};
+
+/**
+@brief Buffer circolare limitato multi-producer/multi-consumer
+
+Coda limitata alla Vyukov: ogni slot contiene un numero di sequenza atomico che indica
+se lo slot è libero per il produttore del giro corrente o pronto per il consumatore.
+Produttori e consumatori si contendono solo l'indice di coda o di testa con una
+compare-and-swap, mentre la pubblicazione dei dati avviene per slot con acquire/release.
+La capacità è una potenza di due (minimo 2).
+
+Le operazioni try_push e try_pop non si bloccano mai; push e pop sono la modalità
+bloccante e attendono con spin e yield. Il comportamento a buffer pieno è dato da
+overflow_policy: con overflow_spin push attende, try_push invece fallisce.
+Gli slot sono allocati tutti alla costruzione, quindi T deve avere un costruttore di default
+e un operatore di assegnamento per copia.
+**/
+template <typename T>
+class mpmc_cbuffer{
+    public:
+        typedef T value_type; ///< Definzione del tipo corrispondente al valore contenuto del buffer
+        typedef std::size_t size_type; ///< Definzione del tipo corrispondente alla dimensione del buffer
+    private:
+        /**
+        @brief Slot del buffer
+
+        seq == pos: slot libero per il produttore della posizione pos,
+        seq == pos + 1: slot pieno per il consumatore della posizione pos
+        **/
+        struct slot {
+            std::atomic<size_type> seq;
+            T value;
+        };
+
+        slot *_buffer; ///< Puntatore all'array di slot
+        size_type _size; ///< Dimensione dell'array, potenza di due
+        size_type _mask; ///< Maschera _size - 1
+        overflow_policy _policy; ///< Comportamento a buffer pieno
+
+        alignas(CBUFFER_CACHE_LINE) std::atomic<size_type> _tail; ///< Prossima posizione da scrivere
+        alignas(CBUFFER_CACHE_LINE) std::atomic<size_type> _head; ///< Prossima posizione da leggere
+        alignas(CBUFFER_CACHE_LINE) std::atomic<size_type> _dropped; ///< Elementi scartati da overflow_overwrite
+
+        mpmc_cbuffer(const mpmc_cbuffer &other) = delete;
+        mpmc_cbuffer &operator=(const mpmc_cbuffer &other) = delete;
+
+        /**
+        @brief Tentativo di inserimento senza politica di overflow
+
+        @return false se il buffer è pieno
+        **/
+        bool enqueue(const T &value){
+            size_type pos = _tail.load(std::memory_order_relaxed);
+            slot *s;
+            for(;;){
+                s = &_buffer[pos & _mask];
+                size_type seq = s->seq.load(std::memory_order_acquire);
+                std::ptrdiff_t dif = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+                if(dif == 0){
+                    if(_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }else if(dif < 0)
+                    return false;
+                else
+                    pos = _tail.load(std::memory_order_relaxed);
+            }
+            s->value = value;
+            s->seq.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+        @brief Scarto in posto dell'elemento più vecchio per overflow_overwrite
+
+        Scarta solo se il buffer è ancora pieno: un consumatore che estrae nel frattempo fa
+        fallire la compare-and-swap sulla testa, e il controllo successivo trova lo slot
+        libero. Il valore non viene spostato fuori, resta nello slot finché un produttore
+        lo sovrascrive
+        @return true se un elemento è stato scartato
+        **/
+        bool drop_oldest(){
+            size_type pos = _head.load(std::memory_order_relaxed);
+            slot *s;
+            for(;;){
+                if(_tail.load(std::memory_order_relaxed) - pos < _size)
+                    return false;
+                s = &_buffer[pos & _mask];
+                size_type seq = s->seq.load(std::memory_order_acquire);
+                std::ptrdiff_t dif = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1);
+                if(dif == 0){
+                    if(_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }else if(dif < 0)
+                    return false;
+                else
+                    pos = _head.load(std::memory_order_relaxed);
+            }
+            s->seq.store(pos + _mask + 1, std::memory_order_release);
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+    public:
+        /**
+        @brief Costruttore con capacità e politica di overflow
+
+        @param size Numero minimo di elementi, arrotondato alla potenza di due successiva
+        @param policy Comportamento quando il buffer è pieno
+        **/
+        explicit mpmc_cbuffer(size_type size, overflow_policy policy = overflow_reject):
+            _buffer(0), _size(2), _mask(0), _policy(policy), _tail(0), _head(0), _dropped(0){
+            while(_size < size)
+                _size <<= 1;
+            _mask = _size - 1;
+            _buffer = new slot[_size];
+            for(size_type i = 0; i < _size; ++i)
+                _buffer[i].seq.store(i, std::memory_order_relaxed);
+        }
+
+        /**
+        @brief Distruttore
+
+        Libera l'array, nessun thread deve più usare il buffer
+        **/
+        ~mpmc_cbuffer(){
+            delete[] _buffer;
+        }
+
+        /**
+        @brief Capacità del buffer
+
+        @return il numero massimo di elementi contenibili, sempre una potenza di due
+        **/
+        size_type size() const {
+            return _size;
+        }
+
+        /**
+        @brief Politica di overflow del buffer
+        **/
+        overflow_policy policy() const {
+            return _policy;
+        }
+
+        /**
+        @brief Elementi scartati
+
+        @return il numero di elementi sovrascritti con overflow_overwrite
+        **/
+        size_type dropped() const {
+            return _dropped.load(std::memory_order_relaxed);
+        }
+
+        /**
+        @brief Inserimento non bloccante
+
+        Se il buffer è pieno con overflow_overwrite scarta l'elemento più vecchio e riprova,
+        con overflow_reject e overflow_spin ritorna false. Lo scarto avviene solo se il buffer
+        è ancora pieno subito prima di avanzare la testa; resta possibile scartare un elemento
+        in più quando un consumatore libera uno slot tra lo scarto e il nuovo tentativo,
+        al più uno per ogni produttore in overwrite concorrente
+        @param value Valore da inserire
+        @return true se l'elemento è stato inserito
+        **/
+        bool try_push(const T &value){
+            for(;;){
+                if(enqueue(value))
+                    return true;
+                if(_policy != overflow_overwrite)
+                    return false;
+                drop_oldest();
+            }
+        }
+
+        /**
+        @brief Inserimento bloccante
+
+        Come try_push, ma con overflow_spin attende che si liberi uno slot
+        @param value Valore da inserire
+        @return true se l'elemento è stato inserito, false solo con overflow_reject e buffer pieno
+        **/
+        bool push(const T &value){
+            if(_policy != overflow_spin)
+                return try_push(value);
+            while(!enqueue(value))
+                std::this_thread::yield();
+            return true;
+        }
+
+        /**
+        @brief Estrazione non bloccante
+
+        @param value Destinazione dell'elemento più vecchio
+        @return true se un elemento è stato estratto, false se il buffer è vuoto
+        **/
+        bool try_pop(T &value){
+            size_type pos = _head.load(std::memory_order_relaxed);
+            slot *s;
+            for(;;){
+                s = &_buffer[pos & _mask];
+                size_type seq = s->seq.load(std::memory_order_acquire);
+                std::ptrdiff_t dif = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1);
+                if(dif == 0){
+                    if(_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }else if(dif < 0)
+                    return false;
+                else
+                    pos = _head.load(std::memory_order_relaxed);
+            }
+            value = std::move(s->value);
+            s->seq.store(pos + _mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+        @brief Estrazione bloccante
+
+        Attende (spin con yield) finché un elemento è disponibile
+        @param value Destinazione dell'elemento più vecchio
+        **/
+        void pop(T &value){
+            while(!try_pop(value))
+                std::this_thread::yield();
+        }
+};
+
 #endif
@@ -0,0 +1,738 @@
+#ifndef CBUFFER_ALGO_H
+#define CBUFFER_ALGO_H
+
+#include "cbuffer.hpp"
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include <thread>
+#include <exception>
+#include <execution>
+
+/**
+@file cbuffer_algo.hpp
+@brief Riduzioni e valutazione di predicati vettorizzate sui cbuffer di tipi aritmetici
+
+Ogni algoritmo lavora sui due tratti contigui del cbuffer (array_one e array_two).
+Per float e double i kernel sono scritti con i vettori di GCC e compilati in tre varianti:
+a 256 bit con AVX2, a 128 bit (SSE2 su x86-64, NEON su ARM) e scalare; la variante
+è scelta a runtime in base alla CPU. Gli altri tipi aritmetici usano cicli scalari.
+evaluate_if_into e filter valutano predicati qualsiasi senza stampare; le versioni con
+una execution policy parallela dividono il cbuffer in blocchi valutati su più thread.
+**/
+
+/**
+@brief Livello di istruzioni vettoriali usato dagli algoritmi
+
+- cbuffer_isa_scalar: nessun vettore
+- cbuffer_isa_vec128: vettori a 128 bit (SSE2 o NEON)
+- cbuffer_isa_avx2: vettori a 256 bit con AVX2
+**/
+enum cbuffer_isa {
+    cbuffer_isa_scalar,
+    cbuffer_isa_vec128,
+    cbuffer_isa_avx2
+};
+
+/**
+@brief Predicato x > value
+
+Con float e double count_if e mask_if lo valutano con i kernel vettoriali
+**/
+template <typename T>
+struct greater_than {
+    T value; ///< Soglia
+    bool operator()(T x) const { return x > value; }
+};
+
+/**
+@brief Predicato x < value
+
+Con float e double count_if e mask_if lo valutano con i kernel vettoriali
+**/
+template <typename T>
+struct less_than {
+    T value; ///< Soglia
+    bool operator()(T x) const { return x < value; }
+};
+
+namespace cbuffer_simd {
+
+/// Livello più alto supportato dalla CPU
+inline cbuffer_isa detect(){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return cbuffer_isa_avx2;
+    if(__builtin_cpu_supports("sse2"))
+        return cbuffer_isa_vec128;
+    return cbuffer_isa_scalar;
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+    return cbuffer_isa_vec128;
+#else
+    return cbuffer_isa_scalar;
+#endif
+}
+
+/// Livello in uso, inizialmente quello della CPU
+inline cbuffer_isa &active(){
+    static cbuffer_isa isa = detect();
+    return isa;
+}
+
+/// true se esistono kernel vettoriali per T
+template <typename T>
+struct vectorized: std::integral_constant<bool,
+    std::is_same<T, float>::value || std::is_same<T, double>::value> {};
+
+/// Vettore di GCC di B byte con elementi T
+template <typename T, int B>
+struct vec {
+    typedef T type __attribute__((vector_size(B)));
+};
+
+/// Confronto con la soglia
+enum compare_op { cmp_greater, cmp_less };
+
+// Kernel su un tratto contiguo di n elementi, B è la larghezza del vettore in byte.
+// Sono always_inline per essere compilati con il target della funzione che li chiama.
+
+// I float sono convertiti in double L alla volta, così che anche il vettore di double sia di B byte
+
+template <int B, typename T>
+__attribute__((always_inline)) inline double sum_run(const T *p, std::size_t n){
+    constexpr int L = B >= 8 ? B / 8 : 1;
+    typedef typename vec<T, L * sizeof(T)>::type vt;
+    typedef typename vec<double, L * 8>::type vd;
+    vd acc[4] = {};
+    std::size_t i = 0;
+    for(; i + 4 * L <= n; i += 4 * L)
+        for(int u = 0; u < 4; ++u){
+            vt a;
+            std::memcpy(&a, p + i + u * L, sizeof(a));
+            acc[u] += __builtin_convertvector(a, vd);
+        }
+    acc[0] += acc[1] + acc[2] + acc[3];
+    double s = 0;
+    for(int l = 0; l < L; ++l)
+        s += acc[0][l];
+    for(; i < n; ++i)
+        s += p[i];
+    return s;
+}
+
+template <int B, typename T>
+__attribute__((always_inline)) inline double sq_dev_run(const T *p, std::size_t n, double mean){
+    constexpr int L = B >= 8 ? B / 8 : 1;
+    typedef typename vec<T, L * sizeof(T)>::type vt;
+    typedef typename vec<double, L * 8>::type vd;
+    vd acc[4] = {};
+    vd m = {};
+    m += mean;
+    std::size_t i = 0;
+    for(; i + 4 * L <= n; i += 4 * L)
+        for(int u = 0; u < 4; ++u){
+            vt a;
+            std::memcpy(&a, p + i + u * L, sizeof(a));
+            vd d = __builtin_convertvector(a, vd) - m;
+            acc[u] += d * d;
+        }
+    acc[0] += acc[1] + acc[2] + acc[3];
+    double s = 0;
+    for(int l = 0; l < L; ++l)
+        s += acc[0][l];
+    for(; i < n; ++i)
+        s += (p[i] - mean) * (p[i] - mean);
+    return s;
+}
+
+template <int B, bool Max, typename T>
+__attribute__((always_inline)) inline T extreme_run(const T *p, std::size_t n, T init){
+    constexpr int W = B / sizeof(T);
+    typedef typename vec<T, B>::type vt;
+    vt acc = {};
+    acc += init;
+    std::size_t i = 0;
+    for(; i + W <= n; i += W){
+        vt a;
+        std::memcpy(&a, p + i, B);
+        if constexpr(Max)
+            acc = a > acc ? a : acc;
+        else
+            acc = a < acc ? a : acc;
+    }
+    T r = init;
+    for(int l = 0; l < W; ++l)
+        r = Max ? (acc[l] > r ? acc[l] : r) : (acc[l] < r ? acc[l] : r);
+    for(; i < n; ++i)
+        r = Max ? (p[i] > r ? p[i] : r) : (p[i] < r ? p[i] : r);
+    return r;
+}
+
+template <int B, compare_op Op, typename T>
+__attribute__((always_inline)) inline std::size_t count_run(const T *p, std::size_t n, T value){
+    constexpr int W = B / sizeof(T);
+    typedef typename vec<T, B>::type vt;
+    vt v = {};
+    v += value;
+    decltype(v < v) acc = {};
+    std::size_t i = 0, c = 0;
+    for(; i + W <= n; i += W){
+        vt a;
+        std::memcpy(&a, p + i, B);
+        // i confronti veri valgono -1; una corsia conta al più n / W < 2^31 elementi
+        acc -= Op == cmp_greater ? a > v : a < v;
+    }
+    for(int l = 0; l < W; ++l)
+        c += acc[l];
+    for(; i < n; ++i)
+        c += Op == cmp_greater ? p[i] > value : p[i] < value;
+    return c;
+}
+
+template <int B, compare_op Op, typename T>
+__attribute__((always_inline)) inline void mask_run(const T *p, std::size_t n, T value,
+        std::uint64_t *bits, std::size_t offset){
+    constexpr int W = B / sizeof(T);
+    typedef typename vec<T, B>::type vt;
+    vt v = {};
+    v += value;
+    std::size_t i = 0;
+    for(; i + W <= n; i += W){
+        vt a;
+        std::memcpy(&a, p + i, B);
+        auto c = Op == cmp_greater ? a > v : a < v;
+        std::uint64_t lanes = 0;
+        for(int l = 0; l < W; ++l)
+            lanes |= (std::uint64_t)(c[l] & 1) << l;
+        std::size_t k = offset + i, shift = k & 63;
+        bits[k >> 6] |= lanes << shift;
+        if(shift + W > 64)
+            bits[(k >> 6) + 1] |= lanes >> (64 - shift);
+    }
+    for(; i < n; ++i)
+        if(Op == cmp_greater ? p[i] > value : p[i] < value){
+            std::size_t k = offset + i;
+            bits[k >> 6] |= (std::uint64_t)1 << (k & 63);
+        }
+}
+
+/// Kernel compilati con il target di default a B byte (B = sizeof(T) è la versione scalare)
+template <typename T, int B>
+struct kernels {
+    static double sum(const T *p, std::size_t n) { return sum_run<B>(p, n); }
+    static double sq_dev(const T *p, std::size_t n, double mean) { return sq_dev_run<B>(p, n, mean); }
+    static T min(const T *p, std::size_t n, T init) { return extreme_run<B, false>(p, n, init); }
+    static T max(const T *p, std::size_t n, T init) { return extreme_run<B, true>(p, n, init); }
+    template <compare_op Op>
+    static std::size_t count(const T *p, std::size_t n, T value) { return count_run<B, Op>(p, n, value); }
+    template <compare_op Op>
+    static void mask(const T *p, std::size_t n, T value, std::uint64_t *bits, std::size_t offset) {
+        mask_run<B, Op>(p, n, value, bits, offset);
+    }
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+/// Kernel compilati per AVX2 a 256 bit
+template <typename T>
+struct kernels_avx2 {
+    __attribute__((target("avx2"))) static double sum(const T *p, std::size_t n) { return sum_run<32>(p, n); }
+    __attribute__((target("avx2"))) static double sq_dev(const T *p, std::size_t n, double mean) {
+        return sq_dev_run<32>(p, n, mean);
+    }
+    __attribute__((target("avx2"))) static T min(const T *p, std::size_t n, T init) {
+        return extreme_run<32, false>(p, n, init);
+    }
+    __attribute__((target("avx2"))) static T max(const T *p, std::size_t n, T init) {
+        return extreme_run<32, true>(p, n, init);
+    }
+    template <compare_op Op>
+    __attribute__((target("avx2"))) static std::size_t count(const T *p, std::size_t n, T value) {
+        return count_run<32, Op>(p, n, value);
+    }
+    template <compare_op Op>
+    __attribute__((target("avx2"))) static void mask(const T *p, std::size_t n, T value,
+            std::uint64_t *bits, std::size_t offset) {
+        mask_run<32, Op>(p, n, value, bits, offset);
+    }
+};
+#else
+template <typename T>
+struct kernels_avx2: kernels<T, 16> {};
+#endif
+
+/**
+@brief Applica f alla famiglia di kernel scelta per il livello attivo
+
+f riceve un oggetto il cui tipo espone i kernel statici
+**/
+template <typename T, typename F>
+inline auto dispatch(F f){
+    switch(active()){
+        case cbuffer_isa_avx2:
+            return f(kernels_avx2<T>());
+        case cbuffer_isa_vec128:
+            return f(kernels<T, 16>());
+        default:
+            return f(kernels<T, sizeof(T)>());
+    }
+}
+
+/// Operazione di confronto corrispondente al predicato, se ne esiste una vettoriale
+template <typename Pred, typename T>
+struct compare_of {
+    static constexpr bool value = false;
+};
+
+template <typename T>
+struct compare_of<greater_than<T>, T> {
+    static constexpr bool value = vectorized<T>::value;
+    static constexpr compare_op op = cmp_greater;
+};
+
+template <typename T>
+struct compare_of<less_than<T>, T> {
+    static constexpr bool value = vectorized<T>::value;
+    static constexpr compare_op op = cmp_less;
+};
+
+/// Genera out_of_range se il cbuffer è vuoto
+template <typename C>
+inline void require_elements(const C &cb){
+    if(cb.empty())
+        throw std::out_of_range("Empty cbuffer");
+}
+
+} // namespace cbuffer_simd
+
+/**
+@brief Livello di istruzioni vettoriali in uso
+
+@return il livello scelto per la CPU corrente o quello impostato con cbuffer_set_isa
+**/
+inline cbuffer_isa cbuffer_get_isa(){
+    return cbuffer_simd::active();
+}
+
+/**
+@brief Imposta il livello di istruzioni vettoriali
+
+Utile per confrontare le varianti; un livello superiore a quello della CPU viene ridotto
+@param isa Livello desiderato
+**/
+inline void cbuffer_set_isa(cbuffer_isa isa){
+    cbuffer_isa max = cbuffer_simd::detect();
+    cbuffer_simd::active() = isa > max ? max : isa;
+}
+
+/**
+@brief Numero di elementi che soddisfano il predicato
+
+Con greater_than e less_than su float e double usa i kernel vettoriali,
+altrimenti valuta pred su ogni elemento dei due tratti contigui
+@param cb Cbuffer da esaminare
+@param pred Predicato unario
+@return il numero di elementi per cui pred è vero
+**/
+template <typename T, typename Policy, typename Allocator, typename Pred>
+std::size_t count_if(const cbuffer<T, Policy, Allocator> &cb, Pred pred){
+    std::span<const T> one = cb.array_one(), two = cb.array_two();
+    if constexpr(cbuffer_simd::compare_of<Pred, T>::value){
+        constexpr cbuffer_simd::compare_op op = cbuffer_simd::compare_of<Pred, T>::op;
+        return cbuffer_simd::dispatch<T>([&](auto k){
+            return k.template count<op>(one.data(), one.size(), pred.value) +
+                   k.template count<op>(two.data(), two.size(), pred.value);
+        });
+    }else{
+        std::size_t c = 0;
+        for(std::size_t i = 0; i < one.size(); ++i)
+            c += pred(one[i]) ? 1 : 0;
+        for(std::size_t i = 0; i < two.size(); ++i)
+            c += pred(two[i]) ? 1 : 0;
+        return c;
+    }
+}
+
+/**
+@brief Valutazione del predicato come maschera di bit
+
+Il bit i (bit i % 64 della parola i / 64) vale 1 se pred è vero per l'elemento logico i.
+Con greater_than e less_than su float e double usa i kernel vettoriali
+@param cb Cbuffer da esaminare
+@param pred Predicato unario
+@param bits Parole di destinazione, almeno (numero di elementi + 63) / 64
+@return il numero di elementi valutati
+**/
+template <typename T, typename Policy, typename Allocator, typename Pred>
+std::size_t mask_if(const cbuffer<T, Policy, Allocator> &cb, Pred pred, std::uint64_t *bits){
+    std::span<const T> one = cb.array_one(), two = cb.array_two();
+    std::size_t n = one.size() + two.size();
+    std::memset(bits, 0, (n + 63) / 64 * sizeof(std::uint64_t));
+    if constexpr(cbuffer_simd::compare_of<Pred, T>::value){
+        constexpr cbuffer_simd::compare_op op = cbuffer_simd::compare_of<Pred, T>::op;
+        cbuffer_simd::dispatch<T>([&](auto k){
+            k.template mask<op>(one.data(), one.size(), pred.value, bits, 0);
+            k.template mask<op>(two.data(), two.size(), pred.value, bits, one.size());
+            return 0;
+        });
+    }else{
+        for(std::size_t i = 0; i < n; ++i)
+            if(pred(i < one.size() ? one[i] : two[i - one.size()]))
+                bits[i >> 6] |= (std::uint64_t)1 << (i & 63);
+    }
+    return n;
+}
+
+/**
+@brief Somma degli elementi
+
+Per float e double la somma è accumulata in double
+@return la somma, double per i tipi in virgola mobile, long long o unsigned long long per gli interi
+**/
+template <typename T, typename Policy, typename Allocator>
+auto sum(const cbuffer<T, Policy, Allocator> &cb){
+    static_assert(std::is_arithmetic<T>::value, "sum requires an arithmetic type");
+    std::span<const T> one = cb.array_one(), two = cb.array_two();
+    if constexpr(cbuffer_simd::vectorized<T>::value){
+        return cbuffer_simd::dispatch<T>([&](auto k){
+            return k.sum(one.data(), one.size()) + k.sum(two.data(), two.size());
+        });
+    }else{
+        typedef typename std::conditional<std::is_floating_point<T>::value, long double,
+            typename std::conditional<std::is_signed<T>::value, long long, unsigned long long>::type>::type acc_type;
+        acc_type s = 0;
+        for(std::size_t i = 0; i < one.size(); ++i)
+            s += one[i];
+        for(std::size_t i = 0; i < two.size(); ++i)
+            s += two[i];
+        return s;
+    }
+}
+
+/**
+@brief Elemento minimo
+
+Se il cbuffer è vuoto genera un eccezione out_of_range
+@return il valore minimo
+**/
+template <typename T, typename Policy, typename Allocator>
+T min_value(const cbuffer<T, Policy, Allocator> &cb){
+    static_assert(std::is_arithmetic<T>::value, "min_value requires an arithmetic type");
+    cbuffer_simd::require_elements(cb);
+    std::span<const T> one = cb.array_one(), two = cb.array_two();
+    if constexpr(cbuffer_simd::vectorized<T>::value){
+        return cbuffer_simd::dispatch<T>([&](auto k){
+            return k.min(two.data(), two.size(), k.min(one.data(), one.size(), one[0]));
+        });
+    }else{
+        T r = one[0];
+        for(std::size_t i = 1; i < one.size(); ++i)
+            r = one[i] < r ? one[i] : r;
+        for(std::size_t i = 0; i < two.size(); ++i)
+            r = two[i] < r ? two[i] : r;
+        return r;
+    }
+}
+
+/**
+@brief Elemento massimo
+
+Se il cbuffer è vuoto genera un eccezione out_of_range
+@return il valore massimo
+**/
+template <typename T, typename Policy, typename Allocator>
+T max_value(const cbuffer<T, Policy, Allocator> &cb){
+    static_assert(std::is_arithmetic<T>::value, "max_value requires an arithmetic type");
+    cbuffer_simd::require_elements(cb);
+    std::span<const T> one = cb.array_one(), two = cb.array_two();
+    if constexpr(cbuffer_simd::vectorized<T>::value){
+        return cbuffer_simd::dispatch<T>([&](auto k){
+            return k.max(two.data(), two.size(), k.max(one.data(), one.size(), one[0]));
+        });
+    }else{
+        T r = one[0];
+        for(std::size_t i = 1; i < one.size(); ++i)
+            r = one[i] > r ? one[i] : r;
+        for(std::size_t i = 0; i < two.size(); ++i)
+            r = two[i] > r ? two[i] : r;
+        return r;
+    }
+}
+
+/**
+@brief Media degli elementi
+
+Se il cbuffer è vuoto genera un eccezione out_of_range
+**/
+template <typename T, typename Policy, typename Allocator>
+double mean(const cbuffer<T, Policy, Allocator> &cb){
+    cbuffer_simd::require_elements(cb);
+    std::size_t n = cb.array_one().size() + cb.array_two().size();
+    return static_cast<double>(sum(cb)) / n;
+}
+
+/**
+@brief Varianza (di popolazione) degli elementi
+
+Calcolata in due passate, media e poi somma dei quadrati degli scarti, per stabilità numerica.
+Se il cbuffer è vuoto genera un eccezione out_of_range
+**/
+template <typename T, typename Policy, typename Allocator>
+double variance(const cbuffer<T, Policy, Allocator> &cb){
+    double m = mean(cb);
+    std::span<const T> one = cb.array_one(), two = cb.array_two();
+    std::size_t n = one.size() + two.size();
+    if constexpr(cbuffer_simd::vectorized<T>::value){
+        return cbuffer_simd::dispatch<T>([&](auto k){
+            return k.sq_dev(one.data(), one.size(), m) + k.sq_dev(two.data(), two.size(), m);
+        }) / n;
+    }else{
+        double s = 0;
+        for(std::size_t i = 0; i < one.size(); ++i)
+            s += (one[i] - m) * (one[i] - m);
+        for(std::size_t i = 0; i < two.size(); ++i)
+            s += (two[i] - m) * (two[i] - m);
+        return s / n;
+    }
+}
+
+#ifndef CBUFFER_PARALLEL_MIN_CHUNK
+/**
+@brief Numero minimo di elementi per blocco nelle versioni parallele degli algoritmi
+**/
+#define CBUFFER_PARALLEL_MIN_CHUNK 256
+#endif
+
+namespace cbuffer_parallel {
+
+/// true se Exec è una execution policy che permette di usare più thread (par e par_unseq, non seq e unseq)
+template <typename Exec>
+struct is_parallel: std::integral_constant<bool,
+    std::is_same<std::remove_cvref_t<Exec>, std::execution::parallel_policy>::value ||
+    std::is_same<std::remove_cvref_t<Exec>, std::execution::parallel_unsequenced_policy>::value> {};
+
+/**
+@brief Esegue f(first, last) su blocchi contigui di [0, n)
+
+Un blocco è eseguito dal thread chiamante, gli altri da thread dedicati; se f genera
+un eccezione questa viene rilanciata dopo che tutti i blocchi sono terminati
+**/
+template <typename F>
+void for_chunks(std::size_t n, F f){
+    std::size_t threads = std::thread::hardware_concurrency();
+    std::size_t max_chunks = (n + CBUFFER_PARALLEL_MIN_CHUNK - 1) / CBUFFER_PARALLEL_MIN_CHUNK;
+    if(threads == 0)
+        threads = 1;
+    if(threads > max_chunks)
+        threads = max_chunks;
+    if(threads <= 1){
+        if(n > 0)
+            f(std::size_t(0), n);
+        return;
+    }
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for(std::size_t t = 1; t < threads; ++t)
+        workers.push_back(std::thread([&f, &errors, n, threads, t](){
+            try{
+                f(n * t / threads, n * (t + 1) / threads);
+            }catch(...){
+                errors[t] = std::current_exception();
+            }
+        }));
+    try{
+        f(std::size_t(0), n / threads);
+    }catch(...){
+        errors[0] = std::current_exception();
+    }
+    for(std::size_t t = 0; t < workers.size(); ++t)
+        workers[t].join();
+    for(std::size_t t = 0; t < threads; ++t)
+        if(errors[t])
+            std::rethrow_exception(errors[t]);
+}
+
+/// Valuta pred sugli elementi logici [first, last) scrivendo 0 o 1 in flags[first, last)
+template <typename T, typename Pred>
+void evaluate_range(std::span<const T> one, std::span<const T> two, Pred &pred,
+        unsigned char *flags, std::size_t first, std::size_t last){
+    std::size_t split = one.size();
+    for(std::size_t i = first; i < last && i < split; ++i)
+        flags[i] = pred(one[i]) ? 1 : 0;
+    for(std::size_t i = first > split ? first : split; i < last; ++i)
+        flags[i] = pred(two[i - split]) ? 1 : 0;
+}
+
+/// Risultati di pred per tutti gli elementi, un byte per elemento, calcolati in parallelo
+template <typename T, typename Policy, typename Allocator, typename Pred>
+std::vector<unsigned char> evaluate(const cbuffer<T, Policy, Allocator> &cb, Pred pred){
+    std::span<const T> one = cb.array_one(), two = cb.array_two();
+    std::vector<unsigned char> flags(one.size() + two.size());
+    for_chunks(flags.size(), [&](std::size_t first, std::size_t last){
+        Pred local(pred);
+        evaluate_range(one, two, local, flags.data(), first, last);
+    });
+    return flags;
+}
+
+} // namespace cbuffer_parallel
+
+/**
+@brief Iteratore segmentato: espone con segment(last) il tratto contiguo successivo
+
+Lo sono gli iteratori di cbuffer; un intervallo di questi iteratori si spezza in al più
+due tratti, prima e dopo il punto di wrap
+**/
+template <typename It>
+concept cbuffer_segmented_iterator = std::random_access_iterator<It> && requires(const It &it){
+    { it.segment(it).size() } -> std::convertible_to<std::size_t>;
+};
+
+/**
+@brief Applica f a ogni tratto contiguo di [first, last)
+
+@param first Inizio dell'intervallo
+@param last Fine dell'intervallo
+@param f Funzione chiamata con uno std::span per tratto, in ordine logico
+**/
+template <typename It, typename F>
+    requires cbuffer_segmented_iterator<It>
+void for_each_segment(It first, It last, F f){
+    while(first != last){
+        auto run = first.segment(last);
+        f(run);
+        first += static_cast<typename std::iterator_traits<It>::difference_type>(run.size());
+    }
+}
+
+/**
+@brief std::copy che per gli iteratori segmentati copia tratto per tratto
+
+Ogni tratto è copiato da std::copy su memoria contigua (memmove se T è banalmente
+copiabile), senza riportare la posizione nell'array a ogni elemento
+@return l'iteratore dopo l'ultimo elemento scritto
+**/
+template <typename It, typename OutputIt>
+OutputIt copy_segmented(It first, It last, OutputIt out){
+    if constexpr(cbuffer_segmented_iterator<It>){
+        for_each_segment(first, last, [&out](auto run){
+            out = std::copy(run.begin(), run.end(), out);
+        });
+        return out;
+    }else
+        return std::copy(first, last, out);
+}
+
+/**
+@brief std::find che per gli iteratori segmentati cerca tratto per tratto
+
+@return l'iteratore al primo elemento uguale a value, last se non c'è
+**/
+template <typename It, typename V>
+It find_segmented(It first, It last, const V &value){
+    if constexpr(cbuffer_segmented_iterator<It>){
+        while(first != last){
+            auto run = first.segment(last);
+            auto found = std::find(run.begin(), run.end(), value);
+            first += static_cast<typename std::iterator_traits<It>::difference_type>(found - run.begin());
+            if(found != run.end())
+                return first;
+        }
+        return last;
+    }else
+        return std::find(first, last, value);
+}
+
+/**
+@brief Valutazione di un predicato su tutti gli elementi
+
+Come evaluate_if, ma invece di stampare scrive su out, in ordine logico, il risultato
+di pred per ogni elemento
+@param cb Cbuffer da esaminare
+@param pred Predicato unario
+@param out Iteratore di output su cui scrivere i bool, ad esempio l'inizio di un std::vector<bool>
+@return l'iteratore dopo l'ultimo risultato scritto
+**/
+template <typename T, typename Policy, typename Allocator, typename Pred, typename OutputIt>
+OutputIt evaluate_if_into(const cbuffer<T, Policy, Allocator> &cb, Pred pred, OutputIt out){
+    std::span<const T> one = cb.array_one(), two = cb.array_two();
+    for(std::size_t i = 0; i < one.size(); ++i, ++out)
+        *out = static_cast<bool>(pred(one[i]));
+    for(std::size_t i = 0; i < two.size(); ++i, ++out)
+        *out = static_cast<bool>(pred(two[i]));
+    return out;
+}
+
+/**
+@brief Valutazione di un predicato su tutti gli elementi con una execution policy
+
+Con std::execution::par o par_unseq il cbuffer è diviso in blocchi contigui valutati
+su più thread (ognuno con una copia di pred), utile con predicati costosi come le regex;
+i risultati sono poi scritti su out in ordine logico. Con std::execution::seq o unseq,
+che non permettono altri thread, equivale alla versione senza policy. Le eccezioni di pred sono propagate al chiamante
+@param exec Execution policy
+@param cb Cbuffer da esaminare
+@param pred Predicato unario
+@param out Iteratore di output su cui scrivere i bool
+@return l'iteratore dopo l'ultimo risultato scritto
+**/
+template <typename Exec, typename T, typename Policy, typename Allocator, typename Pred, typename OutputIt>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Exec> >
+OutputIt evaluate_if_into(Exec &&, const cbuffer<T, Policy, Allocator> &cb, Pred pred, OutputIt out){
+    if constexpr(!cbuffer_parallel::is_parallel<Exec>::value)
+        return evaluate_if_into(cb, pred, out);
+    else{
+        std::vector<unsigned char> flags = cbuffer_parallel::evaluate(cb, pred);
+        for(std::size_t i = 0; i < flags.size(); ++i, ++out)
+            *out = flags[i] != 0;
+        return out;
+    }
+}
+
+/**
+@brief Indici logici degli elementi che soddisfano il predicato
+
+@param cb Cbuffer da esaminare
+@param pred Predicato unario
+@return gli indici, crescenti, utilizzabili con operator[]
+**/
+template <typename T, typename Policy, typename Allocator, typename Pred>
+std::vector<typename cbuffer<T, Policy, Allocator>::size_type> filter(const cbuffer<T, Policy, Allocator> &cb, Pred pred){
+    typedef typename cbuffer<T, Policy, Allocator>::size_type size_type;
+    std::span<const T> one = cb.array_one(), two = cb.array_two();
+    std::vector<size_type> indices;
+    for(std::size_t i = 0; i < one.size(); ++i)
+        if(pred(one[i]))
+            indices.push_back(static_cast<size_type>(i));
+    for(std::size_t i = 0; i < two.size(); ++i)
+        if(pred(two[i]))
+            indices.push_back(static_cast<size_type>(one.size() + i));
+    return indices;
+}
+
+/**
+@brief Indici logici degli elementi che soddisfano il predicato con una execution policy
+
+Stessa divisione in blocchi di evaluate_if_into con execution policy
+**/
+template <typename Exec, typename T, typename Policy, typename Allocator, typename Pred>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Exec> >
+std::vector<typename cbuffer<T, Policy, Allocator>::size_type> filter(Exec &&, const cbuffer<T, Policy, Allocator> &cb, Pred pred){
+    if constexpr(!cbuffer_parallel::is_parallel<Exec>::value)
+        return filter(cb, pred);
+    else{
+        typedef typename cbuffer<T, Policy, Allocator>::size_type size_type;
+        std::vector<unsigned char> flags = cbuffer_parallel::evaluate(cb, pred);
+        std::vector<size_type> indices;
+        for(std::size_t i = 0; i < flags.size(); ++i)
+            if(flags[i])
+                indices.push_back(static_cast<size_type>(i));
+        return indices;
+    }
+}
+
+#endif
@@ -0,0 +1,286 @@
+#ifndef CBUFFER_ALLOC_H
+#define CBUFFER_ALLOC_H
+
+#include <memory_resource>
+#include <cstddef>
+#include <cstdint>
+
+/**
+@file cbuffer_alloc.hpp
+@brief Memory resource per l'array dei cbuffer: arena monotona e pool a blocchi fissi
+
+Entrambe le classi derivano da std::pmr::memory_resource e si usano con pmr_cbuffer,
+ad esempio pmr_cbuffer<voce> cb(64, &cbuffer_thread_arena());
+**/
+
+#ifndef CBUFFER_THREAD_ARENA_SIZE
+/**
+@brief Dimensione in byte dell'arena per thread restituita da cbuffer_thread_arena
+**/
+#define CBUFFER_THREAD_ARENA_SIZE (1 << 20)
+#endif
+
+/**
+@brief Arena monotona
+
+Alloca spostando un puntatore all'interno di un unico blocco ottenuto una sola volta
+dalla risorsa upstream. La deallocazione dell'ultima allocazione riporta indietro il
+puntatore; l'arena conta inoltre le allocazioni ancora vive nel blocco e, quando l'ultima
+viene restituita, torna all'inizio del blocco. Così i cbuffer per richiesta riusano sempre
+la stessa memoria anche se sono distrutti in ordine diverso da quello di creazione.
+Quando il blocco è esaurito le richieste passano alla risorsa upstream.
+release() rende di nuovo disponibile tutto il blocco.
+**/
+class cbuffer_arena: public std::pmr::memory_resource {
+    char *_begin; ///< Inizio del blocco
+    char *_cur; ///< Prima posizione libera
+    char *_last; ///< Fine del blocco
+    std::pmr::memory_resource *_upstream; ///< Risorsa per il blocco e per le richieste in eccesso
+    std::size_t _upstream_allocations; ///< Richieste passate alla risorsa upstream
+    std::size_t _live; ///< Allocazioni nel blocco non ancora restituite
+    bool _owned; ///< true se il blocco è stato allocato dall'arena
+
+    cbuffer_arena(const cbuffer_arena &other) = delete;
+    cbuffer_arena &operator=(const cbuffer_arena &other) = delete;
+
+    bool owns(void *p) const {
+        return static_cast<char *>(p) >= _begin && static_cast<char *>(p) < _last;
+    }
+
+public:
+    /**
+    @brief Costruttore con capacità
+
+    Alloca dalla risorsa upstream un blocco di capacity byte
+    @param capacity Dimensione in byte del blocco
+    @param upstream Risorsa da cui ottenere il blocco e le richieste in eccesso
+    **/
+    explicit cbuffer_arena(std::size_t capacity,
+            std::pmr::memory_resource *upstream = std::pmr::new_delete_resource()):
+        _begin(0), _cur(0), _last(0), _upstream(upstream), _upstream_allocations(0), _live(0), _owned(true){
+        _begin = static_cast<char *>(upstream->allocate(capacity));
+        _cur = _begin;
+        _last = _begin + capacity;
+    }
+
+    /**
+    @brief Costruttore su memoria esterna
+
+    Usa buffer (ad esempio un array sullo stack) senza mai liberarlo
+    @param buffer Memoria da usare
+    @param size Dimensione in byte di buffer
+    @param upstream Risorsa per le richieste in eccesso
+    **/
+    cbuffer_arena(void *buffer, std::size_t size,
+            std::pmr::memory_resource *upstream = std::pmr::new_delete_resource()):
+        _begin(static_cast<char *>(buffer)), _cur(_begin), _last(_begin + size),
+        _upstream(upstream), _upstream_allocations(0), _live(0), _owned(false){
+    }
+
+    /**
+    @brief Distruttore
+
+    Restituisce il blocco alla risorsa upstream, i cbuffer che lo usano devono essere già distrutti
+    **/
+    ~cbuffer_arena(){
+        if(_owned)
+            _upstream->deallocate(_begin, _last - _begin);
+    }
+
+    /**
+    @brief Rende di nuovo disponibile tutto il blocco
+
+    Da chiamare solo quando nessun cbuffer usa più la memoria dell'arena
+    **/
+    void release(){
+        _cur = _begin;
+        _live = 0;
+    }
+
+    /**
+    @brief Byte del blocco attualmente in uso
+    **/
+    std::size_t used() const {
+        return _cur - _begin;
+    }
+
+    /**
+    @brief Dimensione in byte del blocco
+    **/
+    std::size_t capacity() const {
+        return _last - _begin;
+    }
+
+    /**
+    @brief Numero di richieste che non sono entrate nel blocco
+    **/
+    std::size_t upstream_allocations() const {
+        return _upstream_allocations;
+    }
+
+protected:
+    void *do_allocate(std::size_t bytes, std::size_t alignment){
+        std::uintptr_t cur = reinterpret_cast<std::uintptr_t>(_cur);
+        std::uintptr_t aligned = (cur + alignment - 1) & ~(std::uintptr_t)(alignment - 1);
+        if(aligned + bytes <= reinterpret_cast<std::uintptr_t>(_last)){
+            _cur = reinterpret_cast<char *>(aligned + bytes);
+            ++_live;
+            return reinterpret_cast<void *>(aligned);
+        }
+        ++_upstream_allocations;
+        return _upstream->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment){
+        if(!owns(p)){
+            _upstream->deallocate(p, bytes, alignment);
+            return;
+        }
+        if(_live && --_live == 0)
+            _cur = _begin;
+        else if(static_cast<char *>(p) + bytes == _cur)
+            _cur = static_cast<char *>(p);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+        return this == &other;
+    }
+};
+
+/**
+@brief Pool a blocchi di dimensione fissa
+
+Pensato per molti cbuffer della stessa capacità: ogni array occupa esattamente un blocco,
+che alla distruzione del cbuffer torna in una free list e viene riusato in O(1).
+I blocchi sono ricavati da chunk ottenuti dalla risorsa upstream, le richieste più grandi
+di un blocco o con allineamento superiore a max_align_t passano direttamente a upstream.
+**/
+class cbuffer_pool: public std::pmr::memory_resource {
+    /// Nodo della free list, scritto all'inizio dei blocchi liberi
+    struct free_block {
+        free_block *next;
+    };
+
+    /// Intestazione di un chunk, i blocchi seguono allineati a max_align_t
+    struct chunk {
+        chunk *next;
+    };
+
+    std::size_t _block_size; ///< Dimensione di un blocco
+    std::size_t _blocks_per_chunk; ///< Blocchi ricavati da ogni chunk
+    std::pmr::memory_resource *_upstream; ///< Risorsa per chunk e richieste fuori misura
+    free_block *_free; ///< Blocchi liberi
+    chunk *_chunks; ///< Chunk allocati
+    std::size_t _header; ///< Spazio riservato all'intestazione in ogni chunk
+
+    cbuffer_pool(const cbuffer_pool &other) = delete;
+    cbuffer_pool &operator=(const cbuffer_pool &other) = delete;
+
+    std::size_t chunk_bytes() const {
+        return _header + _block_size * _blocks_per_chunk;
+    }
+
+    void grow(){
+        chunk *c = static_cast<chunk *>(_upstream->allocate(chunk_bytes(), alignof(std::max_align_t)));
+        c->next = _chunks;
+        _chunks = c;
+        char *block = reinterpret_cast<char *>(c) + _header;
+        for(std::size_t i = 0; i < _blocks_per_chunk; ++i, block += _block_size){
+            free_block *f = reinterpret_cast<free_block *>(block);
+            f->next = _free;
+            _free = f;
+        }
+    }
+
+    bool fits(std::size_t bytes, std::size_t alignment) const {
+        return bytes <= _block_size && alignment <= alignof(std::max_align_t);
+    }
+
+public:
+    /**
+    @brief Costruttore con dimensione del blocco
+
+    @param block_size Byte per blocco, ad esempio block_for<voce>(64)
+    @param blocks_per_chunk Blocchi da allocare insieme quando la free list è vuota
+    @param upstream Risorsa da cui ottenere i chunk
+    **/
+    explicit cbuffer_pool(std::size_t block_size, std::size_t blocks_per_chunk = 64,
+            std::pmr::memory_resource *upstream = std::pmr::new_delete_resource()):
+        _block_size(0), _blocks_per_chunk(blocks_per_chunk ? blocks_per_chunk : 1),
+        _upstream(upstream), _free(0), _chunks(0), _header(0){
+        const std::size_t align = alignof(std::max_align_t);
+        if(block_size < sizeof(free_block))
+            block_size = sizeof(free_block);
+        _block_size = (block_size + align - 1) / align * align;
+        _header = (sizeof(chunk) + align - 1) / align * align;
+    }
+
+    /**
+    @brief Distruttore
+
+    Restituisce tutti i chunk alla risorsa upstream
+    **/
+    ~cbuffer_pool(){
+        while(_chunks){
+            chunk *next = _chunks->next;
+            _upstream->deallocate(_chunks, chunk_bytes(), alignof(std::max_align_t));
+            _chunks = next;
+        }
+    }
+
+    /**
+    @brief Dimensione di un blocco in byte
+    **/
+    std::size_t block_size() const {
+        return _block_size;
+    }
+
+    /**
+    @brief Byte necessari all'array di un cbuffer<T> di capacità size
+    **/
+    template <typename T>
+    static std::size_t block_for(std::size_t size){
+        return sizeof(T) * size;
+    }
+
+protected:
+    void *do_allocate(std::size_t bytes, std::size_t alignment){
+        if(!fits(bytes, alignment))
+            return _upstream->allocate(bytes, alignment);
+        if(!_free)
+            grow();
+        free_block *f = _free;
+        _free = f->next;
+        return f;
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment){
+        if(!fits(bytes, alignment)){
+            _upstream->deallocate(p, bytes, alignment);
+            return;
+        }
+        free_block *f = static_cast<free_block *>(p);
+        f->next = _free;
+        _free = f;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+        return this == &other;
+    }
+};
+
+/**
+@brief Arena del thread corrente
+
+Ogni thread ha la propria cbuffer_arena di CBUFFER_THREAD_ARENA_SIZE byte, allocata alla prima
+chiamata: i cbuffer per richiesta creati con pmr_cbuffer<T> cb(n, &cbuffer_thread_arena())
+non passano dall'heap globale finché l'arena non è esaurita. Il blocco torna tutto disponibile
+quando l'ultimo cbuffer che lo usa viene distrutto e viene liberato alla fine del thread
+@return riferimento all'arena del thread
+**/
+inline cbuffer_arena &cbuffer_thread_arena(){
+    thread_local cbuffer_arena arena(CBUFFER_THREAD_ARENA_SIZE);
+    return arena;
+}
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef CBUFFER_BENCH_H
+#define CBUFFER_BENCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+@file cbuffer_bench.hpp
+@brief Mini harness per i microbenchmark dei buffer circolari
+**/
+
+/**
+@brief Numero di allocazioni dinamiche eseguite finora dal programma
+
+Deve essere definita dal programma che usa l'harness, di solito sostituendo operator new;
+se le allocazioni non sono contate può restituire sempre 0
+**/
+std::size_t bench_allocation_count();
+
+/**
+@brief Impedisce al compilatore di eliminare il calcolo di value
+**/
+template <typename T>
+inline void bench_keep(const T &value){
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+/**
+@brief Risultato di un microbenchmark
+**/
+struct bench_result {
+    std::string op; ///< Operazione misurata
+    std::string type; ///< Tipo degli elementi
+    long long capacity; ///< Capacità del buffer
+    long long ops; ///< Operazioni eseguite nell'ultima misura
+    double ns_per_op; ///< Nanosecondi per operazione
+    double bytes_per_second; ///< Byte di elementi elaborati al secondo
+    double allocs_per_op; ///< Allocazioni per operazione
+};
+
+/**
+@brief Esecuzione e raccolta dei microbenchmark
+
+Ogni benchmark è una funzione body(n) che esegue circa n operazioni e restituisce quante
+ne ha eseguite davvero (ad esempio arrotondando a copie intere del buffer). Come in
+Google Benchmark, n parte da 1 e cresce finché una misura non dura almeno min_time
+secondi; viene riportata l'ultima misura. Il filtro seleziona i benchmark il cui nome
+op/type/capacity contiene la stringa data
+**/
+class bench_runner {
+    public:
+        typedef std::chrono::steady_clock clock;
+
+        /**
+        @brief Costruttore
+
+        @param min_time Durata minima in secondi della misura riportata
+        @param filter Sottostringa del nome dei benchmark da eseguire, vuota per tutti
+        **/
+        explicit bench_runner(double min_time = 0.05, const std::string &filter = std::string()):
+            _min_time(min_time), _filter(filter), _results() {}
+
+        /**
+        @brief Nome completo di un benchmark
+        **/
+        static std::string name(const std::string &op, const std::string &type, long long capacity){
+            return op + "/" + type + "/" + std::to_string(capacity);
+        }
+
+        /**
+        @brief Controllo se il benchmark è selezionato dal filtro
+        **/
+        bool selected(const std::string &op, const std::string &type, long long capacity) const {
+            return _filter.empty() || name(op, type, capacity).find(_filter) != std::string::npos;
+        }
+
+        /**
+        @brief Misura di un benchmark
+
+        @param op Operazione misurata
+        @param type Tipo degli elementi
+        @param capacity Capacità del buffer
+        @param bytes_per_op Byte di elementi elaborati da ogni operazione
+        @param body Funzione che esegue le operazioni e ne restituisce il numero;
+        se è 0 il benchmark viene saltato senza aggiungere risultati
+        **/
+        template <typename Body>
+        void run(const std::string &op, const std::string &type, long long capacity, double bytes_per_op, Body body){
+            if(!selected(op, type, capacity))
+                return;
+            long long n = 1;
+            for(;;){
+                std::size_t allocs = bench_allocation_count();
+                clock::time_point start = clock::now();
+                long long done = body(n);
+                double secs = std::chrono::duration<double>(clock::now() - start).count();
+                allocs = bench_allocation_count() - allocs;
+                if(done <= 0){
+                    // nessuna operazione misurabile: niente riga con valori infiniti
+                    std::cerr << "skipped " << name(op, type, capacity) << ": no operations" << std::endl;
+                    return;
+                }
+                if(secs >= _min_time || n >= (1LL << 40)){
+                    bench_result r;
+                    r.op = op;
+                    r.type = type;
+                    r.capacity = capacity;
+                    r.ops = done;
+                    r.ns_per_op = secs * 1e9 / done;
+                    r.bytes_per_second = bytes_per_op * done / secs;
+                    r.allocs_per_op = static_cast<double>(allocs) / done;
+                    _results.push_back(r);
+                    return;
+                }
+                // stima delle operazioni per arrivare a min_time, crescendo almeno del doppio
+                double factor = secs > 0 ? 1.4 * _min_time / secs : 100;
+                factor = factor < 2 ? 2 : (factor > 100 ? 100 : factor);
+                n = static_cast<long long>((done > n ? done : n) * factor);
+            }
+        }
+
+        const std::vector<bench_result> &results() const {
+            return _results;
+        }
+
+        /**
+        @brief Stampa dei risultati in CSV con riga di intestazione
+        **/
+        void print_csv(std::ostream &os) const {
+            os << "op,type,capacity,ops,ns_per_op,bytes_per_second,allocs_per_op\n";
+            for(std::size_t i = 0; i < _results.size(); ++i){
+                const bench_result &r = _results[i];
+                os << r.op << "," << r.type << "," << r.capacity << "," << r.ops << ","
+                   << r.ns_per_op << "," << r.bytes_per_second << "," << r.allocs_per_op << "\n";
+            }
+        }
+
+        /**
+        @brief Stampa dei risultati in JSON, un array di oggetti
+        **/
+        void print_json(std::ostream &os) const {
+            os << "[\n";
+            for(std::size_t i = 0; i < _results.size(); ++i){
+                const bench_result &r = _results[i];
+                os << "  {\"op\": \"" << r.op << "\", \"type\": \"" << r.type << "\", \"capacity\": " << r.capacity
+                   << ", \"ops\": " << r.ops << ", \"ns_per_op\": " << r.ns_per_op
+                   << ", \"bytes_per_second\": " << r.bytes_per_second << ", \"allocs_per_op\": " << r.allocs_per_op
+                   << "}" << (i + 1 < _results.size() ? "," : "") << "\n";
+            }
+            os << "]\n";
+        }
+
+        /**
+        @brief Stampa dei risultati come tabella leggibile
+        **/
+        void print_table(std::ostream &os) const {
+            os << std::left << std::setw(36) << "benchmark" << std::right << std::setw(12) << "ns/op"
+               << std::setw(14) << "MB/s" << std::setw(12) << "allocs/op" << "\n";
+            for(std::size_t i = 0; i < _results.size(); ++i){
+                const bench_result &r = _results[i];
+                os << std::left << std::setw(36) << name(r.op, r.type, r.capacity) << std::right
+                   << std::setw(12) << r.ns_per_op << std::setw(14) << r.bytes_per_second / 1e6
+                   << std::setw(12) << r.allocs_per_op << "\n";
+            }
+        }
+
+    private:
+        double _min_time;
+        std::string _filter;
+        std::vector<bench_result> _results;
+};
+
+#endif
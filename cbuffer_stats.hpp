@@ -0,0 +1,344 @@
+#ifndef CBUFFER_STATS_H
+#define CBUFFER_STATS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+@file cbuffer_stats.hpp
+@brief Statistiche di utilizzo di un cbuffer tramite la politica cbuffer_stats_policy
+**/
+
+/**
+@brief Numero di classi dell'istogramma di occupazione
+
+La classe 0 conta il cbuffer vuoto, la classe k > 0 le occupazioni in [2^(k-1), 2^k)
+**/
+#define CBUFFER_STATS_BUCKETS 33
+
+/**
+@brief Fotografia delle statistiche di un cbuffer
+
+Restituita da cbuffer::stats() o, senza capacità e numero di elementi, da
+cbuffer_stats_policy::snapshot(). I tempi sono nanosecondi di steady_clock
+**/
+struct cbuffer_stats {
+    unsigned long long inserts; ///< Elementi aggiunti senza sovrascrivere
+    unsigned long long overwrites; ///< Elementi persi perché sovrascritti
+    unsigned long long removes; ///< Elementi rimossi
+    unsigned long long rejects; ///< Inserimenti e rimozioni rifiutati
+    int capacity; ///< Dimensione del cbuffer, -1 se non nota
+    int count; ///< Elementi presenti, -1 se non noto
+    int high_water; ///< Massimo numero di elementi raggiunto
+    std::array<unsigned long long, CBUFFER_STATS_BUCKETS> occupancy; ///< Elementi inseriti o rimossi per classe di occupazione
+    bool timestamps; ///< true se oldest e newest sono validi
+    long long oldest; ///< Istante di inserimento dell'elemento più vecchio, 0 se vuoto
+    long long newest; ///< Istante di inserimento dell'elemento più recente, 0 se vuoto
+    long long now; ///< Istante della fotografia
+
+    /**
+    @brief Età in secondi dell'elemento più vecchio, cioè il ritardo del consumatore
+
+    @return 0 se il cbuffer è vuoto o i tempi non sono registrati
+    **/
+    double oldest_age() const {
+        return timestamps && oldest ? (now - oldest) * 1e-9 : 0;
+    }
+
+    /**
+    @brief Estremo superiore (escluso) delle occupazioni della classe bucket
+    **/
+    static unsigned long long bucket_limit(int bucket){
+        return bucket == 0 ? 1 : 1ULL << bucket;
+    }
+
+    /**
+    @brief Statistiche in formato testo, una voce per riga
+    **/
+    std::string text() const {
+        std::ostringstream os;
+        os << "inserts: " << inserts << "\noverwrites: " << overwrites << "\nremoves: " << removes
+           << "\nrejects: " << rejects << "\ncapacity: " << capacity << "\ncount: " << count
+           << "\nhigh water: " << high_water << "\noccupancy:";
+        for(int b = 0; b < CBUFFER_STATS_BUCKETS; ++b)
+            if(occupancy[b])
+                os << " <" << bucket_limit(b) << ":" << occupancy[b];
+        if(timestamps)
+            os << "\noldest age: " << oldest_age() << " s";
+        return os.str();
+    }
+
+    /**
+    @brief Statistiche come oggetto JSON
+
+    occupancy è un array di coppie [limite, elementi] per le sole classi non vuote
+    **/
+    std::string json() const {
+        std::ostringstream os;
+        os << "{\"inserts\": " << inserts << ", \"overwrites\": " << overwrites << ", \"removes\": " << removes
+           << ", \"rejects\": " << rejects << ", \"capacity\": " << capacity << ", \"count\": " << count
+           << ", \"high_water\": " << high_water << ", \"occupancy\": [";
+        bool first = true;
+        for(int b = 0; b < CBUFFER_STATS_BUCKETS; ++b)
+            if(occupancy[b]){
+                os << (first ? "" : ", ") << "[" << bucket_limit(b) << ", " << occupancy[b] << "]";
+                first = false;
+            }
+        os << "]";
+        if(timestamps)
+            os << ", \"oldest_ns\": " << oldest << ", \"newest_ns\": " << newest << ", \"oldest_age_s\": " << oldest_age();
+        os << "}";
+        return os.str();
+    }
+};
+
+/**
+@brief Operatore di stream, formato testo
+**/
+inline std::ostream &operator<<(std::ostream &os, const cbuffer_stats &s){
+    return os << s.text();
+}
+
+/**
+@brief Politica di osservazione che raccoglie statistiche di utilizzo
+
+Conta inserimenti, sovrascritture, rimozioni e rifiuti, il massimo numero di elementi e un
+istogramma dell'occupazione (per classi potenza di due, pesato sugli elementi di ogni evento).
+Con Timestamps registra anche l'istante di inserimento di ogni elemento, per conoscere l'età
+del più vecchio: costa una lettura dell'orologio per inserimento e un vettore di istanti
+usato come coda.
+I contatori sono atomici con ordinamento relaxed e, dato che cbuffer ha un solo thread
+che lo modifica, vengono aggiornati con load e store senza operazioni read-modify-write:
+sul percorso critico non ci sono istruzioni lock, e un altro thread può leggerli in ogni
+momento con snapshot(). Senza questa politica (cbuffer_null_policy, il default) il costo è nullo
+**/
+template <bool Timestamps = false>
+class cbuffer_stats_policy {
+    public:
+        typedef std::chrono::steady_clock clock;
+
+        cbuffer_stats_policy(): _inserts(0), _overwrites(0), _removes(0), _rejects(0), _high_water(0),
+            _occupancy(), _times(), _times_head(0), _oldest(0), _newest(0) {
+            for(int b = 0; b < CBUFFER_STATS_BUCKETS; ++b)
+                _occupancy[b].store(0, std::memory_order_relaxed);
+        }
+
+        cbuffer_stats_policy(const cbuffer_stats_policy &other): cbuffer_stats_policy() {
+            *this = other;
+        }
+
+        cbuffer_stats_policy &operator=(const cbuffer_stats_policy &other){
+            copy_counters(other);
+            _times.assign(other._times.begin() + static_cast<std::ptrdiff_t>(other._times_head), other._times.end());
+            _times_head = 0;
+            copy(_oldest, other._oldest);
+            copy(_newest, other._newest);
+            return *this;
+        }
+
+        /**
+        @brief Costruttore per spostamento, senza allocazioni
+
+        Usato da cbuffer nello spostamento e nello swap, che sono noexcept
+        **/
+        cbuffer_stats_policy(cbuffer_stats_policy &&other) noexcept: cbuffer_stats_policy() {
+            *this = std::move(other);
+        }
+
+        cbuffer_stats_policy &operator=(cbuffer_stats_policy &&other) noexcept {
+            copy_counters(other);
+            _times = std::move(other._times);
+            _times_head = other._times_head;
+            other._times.clear();
+            other._times_head = 0;
+            copy(_oldest, other._oldest);
+            copy(_newest, other._newest);
+            other._oldest.store(0, std::memory_order_relaxed);
+            other._newest.store(0, std::memory_order_relaxed);
+            return *this;
+        }
+
+        /**
+        @brief Scambio senza allocazioni
+        **/
+        friend void swap(cbuffer_stats_policy &a, cbuffer_stats_policy &b) noexcept {
+            exchange(a._inserts, b._inserts);
+            exchange(a._overwrites, b._overwrites);
+            exchange(a._removes, b._removes);
+            exchange(a._rejects, b._rejects);
+            exchange(a._high_water, b._high_water);
+            for(int i = 0; i < CBUFFER_STATS_BUCKETS; ++i)
+                exchange(a._occupancy[i], b._occupancy[i]);
+            a._times.swap(b._times);
+            std::swap(a._times_head, b._times_head);
+            exchange(a._oldest, b._oldest);
+            exchange(a._newest, b._newest);
+        }
+
+        template <typename T>
+        void on_insert(const T &, int count) {
+            add(_inserts, 1);
+            sample(count, 1);
+            stamp(1, 0);
+        }
+
+        template <typename T>
+        void on_overwrite(const T &, int count) {
+            add(_overwrites, 1);
+            sample(count, 1);
+            stamp(1, 1);
+        }
+
+        void on_remove(int count) {
+            add(_removes, 1);
+            sample(count, 1);
+            stamp(0, 1);
+        }
+
+        void on_insert_n(int added, int overwritten, int count) {
+            add(_inserts, added);
+            add(_overwrites, overwritten);
+            sample(count, added + overwritten);
+            stamp(added + overwritten, overwritten);
+        }
+
+        void on_remove_n(int removed, int count) {
+            add(_removes, removed);
+            sample(count, removed);
+            stamp(0, removed);
+        }
+
+        void on_reject_insert() { add(_rejects, 1); }
+
+        void on_reject_remove() { add(_rejects, 1); }
+
+        /**
+        @brief Fotografia delle statistiche, leggibile anche da un altro thread
+
+        capacity e count valgono -1: cbuffer::stats() li aggiunge
+        **/
+        cbuffer_stats snapshot() const {
+            cbuffer_stats s;
+            s.inserts = _inserts.load(std::memory_order_relaxed);
+            s.overwrites = _overwrites.load(std::memory_order_relaxed);
+            s.removes = _removes.load(std::memory_order_relaxed);
+            s.rejects = _rejects.load(std::memory_order_relaxed);
+            s.capacity = -1;
+            s.count = -1;
+            s.high_water = _high_water.load(std::memory_order_relaxed);
+            for(int b = 0; b < CBUFFER_STATS_BUCKETS; ++b)
+                s.occupancy[b] = _occupancy[b].load(std::memory_order_relaxed);
+            s.timestamps = Timestamps;
+            s.oldest = _oldest.load(std::memory_order_relaxed);
+            s.newest = _newest.load(std::memory_order_relaxed);
+            s.now = now();
+            return s;
+        }
+
+        /**
+        @brief Fotografia completata con capacità e numero di elementi, usata da cbuffer::stats()
+        **/
+        cbuffer_stats stats(int capacity, int count) const {
+            cbuffer_stats s = snapshot();
+            s.capacity = capacity;
+            s.count = count;
+            return s;
+        }
+
+        /**
+        @brief Azzeramento dei contatori
+
+        Il massimo riparte da 0 e gli istanti degli elementi presenti restano
+        **/
+        void reset_stats(){
+            _inserts.store(0, std::memory_order_relaxed);
+            _overwrites.store(0, std::memory_order_relaxed);
+            _removes.store(0, std::memory_order_relaxed);
+            _rejects.store(0, std::memory_order_relaxed);
+            _high_water.store(0, std::memory_order_relaxed);
+            for(int b = 0; b < CBUFFER_STATS_BUCKETS; ++b)
+                _occupancy[b].store(0, std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<unsigned long long> _inserts;
+        std::atomic<unsigned long long> _overwrites;
+        std::atomic<unsigned long long> _removes;
+        std::atomic<unsigned long long> _rejects;
+        std::atomic<int> _high_water;
+        std::array<std::atomic<unsigned long long>, CBUFFER_STATS_BUCKETS> _occupancy;
+        std::vector<long long> _times; ///< Istanti di inserimento, solo con Timestamps: gli elementi presenti sono da _times_head
+        std::size_t _times_head; ///< Primo istante ancora valido in _times
+        std::atomic<long long> _oldest;
+        std::atomic<long long> _newest;
+
+        static long long now(){
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count();
+        }
+
+        template <typename V>
+        static void copy(std::atomic<V> &to, const std::atomic<V> &from){
+            to.store(from.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+
+        template <typename V>
+        static void exchange(std::atomic<V> &a, std::atomic<V> &b){
+            V value = a.load(std::memory_order_relaxed);
+            copy(a, b);
+            b.store(value, std::memory_order_relaxed);
+        }
+
+        void copy_counters(const cbuffer_stats_policy &other){
+            copy(_inserts, other._inserts);
+            copy(_overwrites, other._overwrites);
+            copy(_removes, other._removes);
+            copy(_rejects, other._rejects);
+            copy(_high_water, other._high_water);
+            for(int b = 0; b < CBUFFER_STATS_BUCKETS; ++b)
+                copy(_occupancy[b], other._occupancy[b]);
+        }
+
+        /// Incremento da parte dell'unico thread che modifica il cbuffer
+        template <typename V>
+        static void add(std::atomic<V> &counter, int n){
+            counter.store(counter.load(std::memory_order_relaxed) + static_cast<V>(n), std::memory_order_relaxed);
+        }
+
+        void sample(int count, int weight){
+            if(count > _high_water.load(std::memory_order_relaxed))
+                _high_water.store(count, std::memory_order_relaxed);
+            add(_occupancy[std::bit_width(static_cast<unsigned>(count))], weight);
+        }
+
+        /// Aggiorna gli istanti: inserted nuovi elementi, dropped più vecchi usciti
+        void stamp(int inserted, int dropped){
+            if constexpr(Timestamps){
+                _times_head = std::min(_times_head + static_cast<std::size_t>(dropped), _times.size());
+                if(_times_head == _times.size()){
+                    _times.clear();
+                    _times_head = 0;
+                }
+                if(inserted > 0){
+                    // compatta la coda quando la parte consumata è almeno metà, costo ammortizzato O(1)
+                    if(_times_head > 0 && 2 * _times_head >= _times.size()){
+                        _times.erase(_times.begin(), _times.begin() + static_cast<std::ptrdiff_t>(_times_head));
+                        _times_head = 0;
+                    }
+                    _times.insert(_times.end(), static_cast<std::size_t>(inserted), now());
+                }
+                bool empty = _times_head == _times.size();
+                _oldest.store(empty ? 0 : _times[_times_head], std::memory_order_relaxed);
+                _newest.store(empty ? 0 : _times.back(), std::memory_order_relaxed);
+            }
+        }
+};
+
+#endif
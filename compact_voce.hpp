@@ -0,0 +1,457 @@
+#ifndef COMPACT_VOCE_H
+#define COMPACT_VOCE_H
+
+#include "cbuffer.hpp"
+#include "voce.h"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+/**
+@file compact_voce.hpp
+@brief Rappresentazioni compatte di voce per i buffer circolari
+
+voce possiede tre std::string: in un cbuffer<voce> pieno ogni sovrascrittura libera e alloca
+stringhe. Qui ci sono due alternative senza allocazioni a regime:
+- compact_voce: cognome e nome come indici in una tabella di interning condivisa
+  (voce_intern_table), ntel in un array interno di dimensione fissa. È banalmente copiabile
+  e si usa direttamente con cbuffer<compact_voce>
+- voce_ring: buffer circolare di voci le cui stringhe stanno in una string_ring_arena,
+  un'area di byte circolare che viene liberata in ordine FIFO insieme alle voci rimosse
+**/
+
+#ifndef COMPACT_VOCE_NTEL_SIZE
+/**
+@brief Numero massimo di caratteri di compact_voce::ntel
+**/
+#define COMPACT_VOCE_NTEL_SIZE 23
+#endif
+
+/**
+@brief Voce in sola lettura, i campi puntano a memoria posseduta da altri
+
+Restituita da compact_voce::view e da voce_ring::operator[]
+**/
+struct voce_view {
+    std::string_view cognome; ///< cognome del contatto
+    std::string_view nome; ///< nome del contatto
+    std::string_view ntel; ///< numero telefonico del contatto
+
+    /**
+    @brief Copia in una voce, allocando le stringhe
+    **/
+    voce to_voce() const {
+        return voce(std::string(cognome), std::string(nome), std::string(ntel));
+    }
+};
+
+/**
+@brief Operatore di stream, stesso formato di voce
+**/
+inline std::ostream &operator<<(std::ostream &os, const voce_view &v){
+    return os << v.cognome << " " << v.nome << " " << v.ntel;
+}
+
+/**
+@brief Tabella di interning di stringhe
+
+Ogni stringa distinta è memorizzata una sola volta e identificata da un indice a 32 bit,
+0 è la stringa vuota. I caratteri stanno in blocchi che non vengono mai spostati, la ricerca
+usa una tabella hash a indirizzamento aperto: intern di una stringa già presente non alloca.
+Le stringhe restano nella tabella fino alla sua distruzione
+**/
+class voce_intern_table {
+        static const std::size_t block_size = 4096; ///< Dimensione minima di un blocco di caratteri
+
+        std::vector<std::unique_ptr<char[]> > _blocks; ///< Blocchi di caratteri
+        std::size_t _block_used; ///< Byte usati nell'ultimo blocco
+        std::size_t _block_capacity; ///< Dimensione dell'ultimo blocco
+        std::vector<std::string_view> _strings; ///< Stringa per indice
+        std::vector<std::uint32_t> _slots; ///< Tabella hash, indice + 1 o 0 se lo slot è libero
+
+        voce_intern_table(const voce_intern_table &other) = delete;
+        voce_intern_table &operator=(const voce_intern_table &other) = delete;
+
+        std::size_t slot_of(std::string_view s) const {
+            return std::hash<std::string_view>()(s) & (_slots.size() - 1);
+        }
+
+        void grow(){
+            std::vector<std::uint32_t> slots(_slots.size() * 2, 0);
+            _slots.swap(slots);
+            for(std::uint32_t id = 1; id < _strings.size(); ++id){
+                std::size_t i = slot_of(_strings[id]);
+                while(_slots[i])
+                    i = (i + 1) & (_slots.size() - 1);
+                _slots[i] = id + 1;
+            }
+        }
+
+        std::string_view store(std::string_view s){
+            if(_blocks.empty() || _block_capacity - _block_used < s.size()){
+                _block_capacity = s.size() > block_size ? s.size() : block_size;
+                _blocks.push_back(std::unique_ptr<char[]>(new char[_block_capacity]));
+                _block_used = 0;
+            }
+            char *p = _blocks.back().get() + _block_used;
+            std::memcpy(p, s.data(), s.size());
+            _block_used += s.size();
+            return std::string_view(p, s.size());
+        }
+
+    public:
+        /**
+        @brief Costruttore
+
+        @param expected Numero di stringhe distinte previste, per dimensionare la tabella hash
+        **/
+        explicit voce_intern_table(std::size_t expected = 64):
+            _blocks(), _block_used(0), _block_capacity(0), _strings(1), _slots() {
+            std::size_t n = 16;
+            while(n < expected * 2)
+                n <<= 1;
+            _slots.assign(n, 0);
+            _strings.reserve(expected + 1);
+        }
+
+        /**
+        @brief Indice della stringa, aggiunta alla tabella se non presente
+
+        @param s Stringa da cercare
+        @return l'indice di s, 0 per la stringa vuota
+        **/
+        std::uint32_t intern(std::string_view s){
+            if(s.empty())
+                return 0;
+            std::size_t i = slot_of(s);
+            for(; _slots[i]; i = (i + 1) & (_slots.size() - 1))
+                if(_strings[_slots[i] - 1] == s)
+                    return _slots[i] - 1;
+            std::uint32_t id = static_cast<std::uint32_t>(_strings.size());
+            _strings.push_back(store(s));
+            _slots[i] = id + 1;
+            if(_strings.size() * 2 > _slots.size())
+                grow();
+            return id;
+        }
+
+        /**
+        @brief Stringa con indice id
+
+        Genera un eccezione out_of_range se id non è stato restituito da intern
+        **/
+        std::string_view str(std::uint32_t id) const {
+            if(id >= _strings.size())
+                throw std::out_of_range("Unknown interned string");
+            return _strings[id];
+        }
+
+        /**
+        @brief Numero di stringhe distinte, inclusa la stringa vuota
+        **/
+        std::size_t size() const {
+            return _strings.size();
+        }
+};
+
+/**
+@brief Voce compatta e banalmente copiabile
+
+cognome e nome sono indici in una voce_intern_table, ntel è memorizzato nell'oggetto:
+32 byte invece dei 96 di voce, nessuna allocazione per inserirla o sovrascriverla in un cbuffer
+**/
+struct compact_voce {
+    std::uint32_t cognome; ///< Indice del cognome nella tabella
+    std::uint32_t nome; ///< Indice del nome nella tabella
+    char ntel[COMPACT_VOCE_NTEL_SIZE]; ///< Caratteri del numero telefonico
+    unsigned char ntel_length; ///< Lunghezza del numero telefonico
+
+    compact_voce(): cognome(0), nome(0), ntel(), ntel_length(0) {}
+
+    /**
+    @brief Costruttore dai campi
+
+    Genera un eccezione length_error se t supera COMPACT_VOCE_NTEL_SIZE caratteri
+    @param table Tabella in cui registrare cognome e nome
+    @param c cognome del contatto
+    @param n nome del contatto
+    @param t numero telefonico del contatto
+    **/
+    compact_voce(voce_intern_table &table, std::string_view c, std::string_view n, std::string_view t):
+        cognome(table.intern(c)), nome(table.intern(n)), ntel(), ntel_length(0) {
+        if(t.size() > COMPACT_VOCE_NTEL_SIZE)
+            throw std::length_error("ntel too long for compact_voce");
+        std::memcpy(ntel, t.data(), t.size());
+        ntel_length = static_cast<unsigned char>(t.size());
+    }
+
+    /**
+    @brief Costruttore da una voce
+    **/
+    compact_voce(voce_intern_table &table, const voce &v): compact_voce(table, v.cognome, v.nome, v.ntel) {}
+
+    /**
+    @brief Numero telefonico
+    **/
+    std::string_view phone() const {
+        return std::string_view(ntel, ntel_length);
+    }
+
+    /**
+    @brief Campi della voce, con cognome e nome letti da table
+    **/
+    voce_view view(const voce_intern_table &table) const {
+        voce_view v = {table.str(cognome), table.str(nome), phone()};
+        return v;
+    }
+};
+
+/**
+@brief Area di byte circolare con liberazione FIFO
+
+Le stringhe sono scritte una dopo l'altra in un unico blocco allocato dal costruttore e
+vengono liberate nello stesso ordine in cui sono state allocate. Un'allocazione non viene
+mai divisa: se non entra prima della fine del blocco riparte dall'inizio e i byte rimasti
+alla fine vengono liberati insieme ad essa
+**/
+class string_ring_arena {
+        std::unique_ptr<char[]> _buffer; ///< Blocco di byte
+        std::size_t _capacity; ///< Dimensione del blocco
+        std::size_t _head; ///< Offset del primo byte in uso
+        std::size_t _tail; ///< Offset della prossima allocazione, minore di _capacity
+        std::size_t _used; ///< Byte in uso, inclusi quelli saltati alla fine del blocco
+
+        string_ring_arena(const string_ring_arena &other) = delete;
+        string_ring_arena &operator=(const string_ring_arena &other) = delete;
+
+    public:
+        /**
+        @brief Costruttore con capacità
+
+        @param capacity Dimensione in byte del blocco
+        **/
+        explicit string_ring_arena(std::size_t capacity):
+            _buffer(new char[capacity > 0 ? capacity : 1]), _capacity(capacity), _head(0), _tail(0), _used(0) {}
+
+        /**
+        @brief Allocazione di n byte contigui in coda
+
+        @param n Numero di byte
+        @param offset Offset dei byte allocati, valido solo se l'allocazione riesce
+        @return false se non c'è abbastanza spazio contiguo libero
+        **/
+        bool try_allocate(std::size_t n, std::size_t &offset){
+            if(_used == 0)
+                _head = _tail = 0;
+            std::size_t skipped = 0;
+            if(_used == _capacity && n > 0)
+                return false;
+            if(_tail >= _head){
+                if(n > _capacity - _tail){
+                    if(n > _head)
+                        return false;
+                    skipped = _capacity - _tail;
+                    _tail = 0;
+                }
+            }else if(n > _head - _tail)
+                return false;
+            offset = _tail;
+            _tail += n;
+            if(_tail == _capacity)
+                _tail = 0;
+            _used += skipped + n;
+            return true;
+        }
+
+        /**
+        @brief Liberazione dell'allocazione più vecchia
+
+        @pre offset e n sono quelli dell'allocazione più vecchia ancora in uso,
+        le allocazioni di 0 byte possono essere liberate in qualsiasi momento
+        **/
+        void release(std::size_t offset, std::size_t n){
+            if(n == 0)
+                return; // non occupa byte, l'arena può essere già stata riavvolta
+            std::size_t freed = (offset >= _head ? offset - _head : _capacity - _head + offset) + n;
+            _used -= freed;
+            _head = offset + n;
+            if(_head == _capacity)
+                _head = 0;
+        }
+
+        char *data(std::size_t offset){
+            return _buffer.get() + offset;
+        }
+
+        const char *data(std::size_t offset) const {
+            return _buffer.get() + offset;
+        }
+
+        /**
+        @brief Byte in uso
+        **/
+        std::size_t used() const {
+            return _used;
+        }
+
+        /**
+        @brief Dimensione del blocco
+        **/
+        std::size_t capacity() const {
+            return _capacity;
+        }
+};
+
+/**
+@brief Buffer circolare di voci con le stringhe in una string_ring_arena
+
+Ogni voce occupa uno slot di un cbuffer di descrittori e un intervallo dell'arena con
+cognome, nome e ntel uno dopo l'altro. Quando i descrittori o i byte dell'arena non bastano
+le voci più vecchie vengono rimosse e il loro spazio nell'arena liberato, come la
+sovrascrittura di cbuffer: dopo il costruttore gli inserimenti non allocano
+**/
+class voce_ring {
+    public:
+        typedef int size_type; ///< Definzione del tipo corrispondente alla dimensione del buffer
+    private:
+        /// Posizione di una voce nell'arena
+        struct entry {
+            std::uint32_t offset;
+            std::uint16_t cognome_length;
+            std::uint16_t nome_length;
+            std::uint16_t ntel_length;
+
+            std::size_t bytes() const {
+                return std::size_t(cognome_length) + nome_length + ntel_length;
+            }
+        };
+
+        cbuffer<entry> _entries; ///< Descrittori delle voci, dal più vecchio
+        string_ring_arena _arena; ///< Caratteri delle voci
+
+        void evict_oldest(){
+            const entry &e = _entries[0];
+            _arena.release(e.offset, e.bytes());
+            _entries.remove();
+        }
+
+    public:
+        /**
+        @brief Costruttore
+
+        @param size Numero massimo di voci
+        @param bytes Dimensione in byte dell'arena per le stringhe
+        **/
+        voce_ring(size_type size, std::size_t bytes): _entries(size), _arena(bytes) {}
+
+        /**
+        @brief Inserimento di una voce in coda
+
+        Rimuove le voci più vecchie finché c'è spazio. Genera un eccezione length_error se
+        la voce non entra nell'arena vuota o un campo supera 65535 caratteri
+        @return insert_added, insert_overwritten se sono state rimosse delle voci,
+        insert_rejected se il buffer ha dimensione 0
+        **/
+        insert_result insert(std::string_view c, std::string_view n, std::string_view t){
+            if(_entries.size() == 0)
+                return insert_rejected;
+            if(c.size() > 0xffff || n.size() > 0xffff || t.size() > 0xffff
+                || c.size() + n.size() + t.size() > _arena.capacity())
+                throw std::length_error("voce too long for voce_ring");
+            entry e = {0, static_cast<std::uint16_t>(c.size()), static_cast<std::uint16_t>(n.size()),
+                       static_cast<std::uint16_t>(t.size())};
+            insert_result r = insert_added;
+            if(_entries.full()){
+                evict_oldest();
+                r = insert_overwritten;
+            }
+            std::size_t offset;
+            while(!_arena.try_allocate(e.bytes(), offset)){
+                evict_oldest();
+                r = insert_overwritten;
+            }
+            char *p = _arena.data(offset);
+            std::memcpy(p, c.data(), c.size());
+            std::memcpy(p + c.size(), n.data(), n.size());
+            std::memcpy(p + c.size() + n.size(), t.data(), t.size());
+            e.offset = static_cast<std::uint32_t>(offset);
+            _entries.insert(e);
+            return r;
+        }
+
+        /**
+        @brief Inserimento di una voce in coda
+        **/
+        insert_result insert(const voce &v){
+            return insert(v.cognome, v.nome, v.ntel);
+        }
+
+        /**
+        @brief Rimozione della voce più vecchia
+
+        @return true se una voce è stata rimossa, false se il buffer era vuoto
+        **/
+        bool remove(){
+            if(_entries.empty())
+                return false;
+            evict_oldest();
+            return true;
+        }
+
+        /**
+        @brief Accesso a una voce
+
+        Genera un eccezione out_of_range se index non è minore del numero di voci.
+        La vista resta valida finché la voce non viene rimossa
+        @param index Indice logico, 0 è la voce più vecchia
+        **/
+        voce_view operator[](size_type index) const {
+            const entry &e = _entries[index];
+            const char *p = _arena.data(e.offset);
+            voce_view v = {std::string_view(p, e.cognome_length),
+                           std::string_view(p + e.cognome_length, e.nome_length),
+                           std::string_view(p + e.cognome_length + e.nome_length, e.ntel_length)};
+            return v;
+        }
+
+        bool empty() const {
+            return _entries.empty();
+        }
+
+        /**
+        @brief Numero massimo di voci
+        **/
+        size_type size() const {
+            return _entries.size();
+        }
+
+        /**
+        @brief Numero di voci presenti
+        **/
+        size_type count() const {
+            return static_cast<size_type>(_entries.array_one().size() + _entries.array_two().size());
+        }
+
+        /**
+        @brief Byte dell'arena in uso
+        **/
+        std::size_t bytes_used() const {
+            return _arena.used();
+        }
+};
+
+/**
+@brief Operatore di stream, stesso formato di cbuffer<voce>
+**/
+inline std::ostream &operator<<(std::ostream &os, const voce_ring &ring){
+    if(ring.empty())
+        return os << "Empty cbuffer";
+    for(voce_ring::size_type i = 0; i < ring.count(); ++i)
+        os << "[" << ring[i] << "]";
+    return os;
+}
+
+#endif
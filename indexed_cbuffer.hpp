@@ -0,0 +1,304 @@
+#ifndef INDEXED_CBUFFER_H
+#define INDEXED_CBUFFER_H
+
+#include "cbuffer.hpp"
+#include "voce.h"
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/**
+@file indexed_cbuffer.hpp
+@brief Dichiarazione della classe indexed_cbuffer, buffer circolare con indice hash
+**/
+
+/**
+@brief Chiave di ricerca voce::ntel
+**/
+struct voce_ntel_key {
+    std::string_view operator()(const voce &v) const { return v.ntel; }
+};
+
+/**
+@brief Chiave di ricerca voce::cognome
+**/
+struct voce_cognome_key {
+    std::string_view operator()(const voce &v) const { return v.cognome; }
+};
+
+/**
+@brief Buffer circolare con indice hash su una chiave degli elementi
+
+KeyOf estrae la chiave da un elemento (ad esempio voce_ntel_key); la chiave può riferirsi
+alla memoria dell'elemento, come uno string_view, perché viene letta solo mentre
+l'elemento è nel buffer. L'indice è una tabella a indirizzamento aperto con scansione lineare
+di dimensione fissa, almeno il doppio della capacità, con una voce per ogni chiave distinta:
+il numero di sequenza di inserimento dell'elemento più recente con quella chiave e quanti
+elementi la condividono. Gli elementi con la stessa chiave sono collegati all'indietro
+da una catena di numeri di sequenza, lunga quanto il buffer. La posizione logica è la
+differenza con il numero di sequenza del più vecchio, quindi rimozioni e sovrascritture
+non spostano le altre voci dell'indice. Il valore di Hash viene rimescolato (hashing di
+Fibonacci) prima di scegliere lo slot, così anche std::hash<int>, che è l'identità, non crea
+lunghe sequenze di probing con chiavi consecutive. Le voci eliminate vengono compattate
+spostando indietro le successive, senza tombstone.
+Inserimento, sovrascrittura del più vecchio, rimozione, find, contains e count costano O(1)
+attesi anche con molte chiavi duplicate; find_all costa O(elementi con la chiave).
+Gli elementi sono accessibili solo in lettura
+**/
+template <typename T, typename KeyOf, typename Hash = std::hash<std::remove_cvref_t<std::invoke_result_t<KeyOf, const T &> > >,
+          typename KeyEqual = std::equal_to<std::remove_cvref_t<std::invoke_result_t<KeyOf, const T &> > > >
+class indexed_cbuffer {
+    public:
+        typedef T value_type; ///< Definzione del tipo corrispondente al valore contenuto del buffer
+        typedef std::remove_cvref_t<std::invoke_result_t<KeyOf, const T &> > key_type; ///< Tipo della chiave
+        typedef typename cbuffer<T>::size_type size_type; ///< Definzione del tipo corrispondente a size
+        typedef typename cbuffer<T>::const_iterator const_iterator; ///< Iteratore in ordine logico
+    private:
+        /// Voce dell'indice per una chiave distinta, newest 0 indica uno slot libero
+        struct slot {
+            std::uint64_t newest; ///< Numero di sequenza dell'elemento più recente con la chiave
+            std::size_t hash; ///< Valore di Hash della chiave
+            size_type count; ///< Elementi con la chiave
+        };
+
+        cbuffer<T> _elements; ///< Elementi
+        std::vector<slot> _index; ///< Tabella hash, dimensione potenza di due
+        std::vector<std::uint64_t> _prev; ///< Per ogni elemento (seq % capacità) il seq precedente con la stessa chiave
+        int _shift; ///< 64 - log2(_index.size())
+        std::size_t _mask; ///< _index.size() - 1
+        std::uint64_t _first; ///< Numero di sequenza dell'elemento più vecchio
+        std::uint64_t _next; ///< Numero di sequenza del prossimo inserimento
+        KeyOf _key;
+        Hash _hash;
+        KeyEqual _equal;
+
+        const T &element(std::uint64_t seq) const {
+            return _elements[static_cast<size_type>(seq - _first)];
+        }
+
+        std::uint64_t &prev(std::uint64_t seq){
+            return _prev[static_cast<std::size_t>(seq % _prev.size())];
+        }
+
+        std::uint64_t prev(std::uint64_t seq) const {
+            return _prev[static_cast<std::size_t>(seq % _prev.size())];
+        }
+
+        /// Slot naturale: i bit alti del prodotto con 2^64 / phi
+        std::size_t home(std::size_t h) const {
+            return static_cast<std::size_t>((static_cast<std::uint64_t>(h) * 0x9E3779B97F4A7C15ULL) >> _shift);
+        }
+
+        /// Slot della chiave key con hash h, o lo slot libero in cui andrebbe inserita
+        std::size_t locate(const key_type &key, std::size_t h) const {
+            std::size_t i = home(h);
+            while(_index[i].newest && !(_index[i].hash == h && _equal(_key(element(_index[i].newest)), key)))
+                i = (i + 1) & _mask;
+            return i;
+        }
+
+        void index_insert(std::uint64_t seq){
+            const key_type &key = _key(element(seq));
+            std::size_t h = _hash(key);
+            slot &s = _index[locate(key, h)];
+            if(s.newest){
+                prev(seq) = s.newest;
+                ++s.count;
+            }else{
+                prev(seq) = 0;
+                s.hash = h;
+                s.count = 1;
+            }
+            s.newest = seq;
+        }
+
+        /// Elimina la voce in i e compatta la sequenza di probing
+        void index_erase(std::size_t i){
+            std::size_t j = i;
+            for(;;){
+                j = (j + 1) & _mask;
+                if(!_index[j].newest)
+                    break;
+                std::size_t h = home(_index[j].hash);
+                // la voce in j può riempire il buco in i se la sua posizione naturale non sta in (i, j]
+                bool movable = i <= j ? (h <= i || h > j) : (h <= i && h > j);
+                if(movable){
+                    _index[i] = _index[j];
+                    i = j;
+                }
+            }
+            _index[i].newest = 0;
+        }
+
+        void evict_oldest(){
+            const key_type &key = _key(element(_first));
+            std::size_t i = locate(key, _hash(key));
+            if(--_index[i].count == 0)
+                index_erase(i);
+            ++_first;
+        }
+
+        template <typename V>
+        insert_result insert_value(V &&value){
+            if(_elements.size() == 0)
+                return insert_rejected;
+            if(_elements.full())
+                evict_oldest();
+            insert_result r = _elements.insert(std::forward<V>(value));
+            index_insert(_next++);
+            return r;
+        }
+
+    public:
+        /**
+        @brief Costruttore con capacità
+
+        @param size Capacità del buffer
+        @param key Estrattore della chiave
+        **/
+        explicit indexed_cbuffer(size_type size, const KeyOf &key = KeyOf(), const Hash &hash = Hash(),
+                const KeyEqual &equal = KeyEqual()):
+            _elements(size), _index(), _prev(size > 0 ? size : 1, 0), _shift(63), _mask(0), _first(1), _next(1),
+            _key(key), _hash(hash), _equal(equal) {
+            std::size_t n = 2;
+            while(n < 2 * static_cast<std::size_t>(size > 0 ? size : 1)){
+                n <<= 1;
+                --_shift;
+            }
+            _index.assign(n, slot());
+            _mask = n - 1;
+        }
+
+        /**
+        @brief Inserimento di un elemento in coda
+
+        Se il buffer è pieno il più vecchio viene tolto dall'indice e sovrascritto
+        @return l'esito dell'inserimento
+        **/
+        insert_result insert(const T &value){
+            return insert_value(value);
+        }
+
+        insert_result insert(T &&value){
+            return insert_value(std::move(value));
+        }
+
+        /**
+        @brief Rimozione dell'elemento più vecchio
+
+        @return true se un elemento è stato rimosso, false se il buffer era vuoto
+        **/
+        bool remove(){
+            if(_elements.empty())
+                return false;
+            evict_oldest();
+            return _elements.remove();
+        }
+
+        /**
+        @brief Estrazione dell'elemento più vecchio
+
+        Se il buffer è vuoto genera un eccezione out_of_range
+        **/
+        T pop(){
+            if(_elements.empty())
+                throw std::out_of_range("Pop from empty cbuffer");
+            evict_oldest();
+            return _elements.pop();
+        }
+
+        /**
+        @brief Posizione logica dell'elemento più recente con chiave key
+
+        @return l'indice logico, utilizzabile con operator[], o -1 se la chiave non è presente
+        **/
+        size_type find(const key_type &key) const {
+            const slot &s = _index[locate(key, _hash(key))];
+            return s.newest ? static_cast<size_type>(s.newest - _first) : -1;
+        }
+
+        /**
+        @brief Posizioni logiche di tutti gli elementi con chiave key, in ordine crescente
+        **/
+        std::vector<size_type> find_all(const key_type &key) const {
+            std::vector<size_type> positions;
+            const slot &s = _index[locate(key, _hash(key))];
+            if(!s.newest)
+                return positions;
+            positions.resize(static_cast<std::size_t>(s.count));
+            std::uint64_t seq = s.newest;
+            for(std::size_t k = positions.size(); k > 0; --k, seq = prev(seq))
+                positions[k - 1] = static_cast<size_type>(seq - _first);
+            return positions;
+        }
+
+        /**
+        @brief Controllo se esiste un elemento con chiave key
+        **/
+        bool contains(const key_type &key) const {
+            return _index[locate(key, _hash(key))].newest != 0;
+        }
+
+        /**
+        @brief Numero di elementi con chiave key
+        **/
+        size_type count(const key_type &key) const {
+            const slot &s = _index[locate(key, _hash(key))];
+            return s.newest ? s.count : 0;
+        }
+
+        /**
+        @brief Elementi come cbuffer in sola lettura
+        **/
+        const cbuffer<T> &elements() const {
+            return _elements;
+        }
+
+        const T &operator[](size_type index) const {
+            return _elements[index];
+        }
+
+        bool empty() const {
+            return _elements.empty();
+        }
+
+        bool full() const {
+            return _elements.full();
+        }
+
+        /**
+        @brief Capacità del buffer
+        **/
+        size_type size() const {
+            return _elements.size();
+        }
+
+        /**
+        @brief Numero di elementi presenti
+        **/
+        size_type count() const {
+            return static_cast<size_type>(_next - _first);
+        }
+
+        const_iterator begin() const {
+            return _elements.begin();
+        }
+
+        const_iterator end() const {
+            return _elements.end();
+        }
+};
+
+/**
+@brief Operatore di stream
+
+Stesso formato di cbuffer
+**/
+template <typename T, typename KeyOf, typename Hash, typename KeyEqual>
+std::ostream &operator<<(std::ostream &os, const indexed_cbuffer<T, KeyOf, Hash, KeyEqual> &cb){
+    return os << cb.elements();
+}
+
+#endif
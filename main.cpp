@@ -1,6 +1,68 @@
 #include "cbuffer.hpp"
+#include "cbuffer_alloc.hpp"
+#include "static_cbuffer.hpp"
+#include "mirrored_cbuffer.hpp"
+#include "cbuffer_algo.hpp"
+#include "windowed_cbuffer.hpp"
+#include "soa_cbuffer.hpp"
+#include "compact_voce.hpp"
+#include "indexed_cbuffer.hpp"
+#include "blocking_cbuffer.hpp"
+#include "async_cbuffer.hpp"
+#include "persistent_cbuffer.hpp"
+#include "cbuffer_stats.hpp"
 #include "voce.h"
 #include <list>
+#include <thread>
+#include <vector>
+#include <new>
+#include <cstdlib>
+#include <chrono>
+#include <sstream>
+#include <iterator>
+#include <ranges>
+#include <functional>
+#include <cstring>
+#include <cmath>
+#include <regex>
+#include <execution>
+#include <optional>
+#ifdef __linux__
+#include <sys/wait.h>
+#endif
+
+/**
+@brief Numero di allocazioni dinamiche eseguite dal programma
+
+Incrementato dalle versioni sostituite di operator new, usato da test_move_allocations;
+atomico perché anche i thread di test_filter allocano
+**/
+static std::atomic<std::size_t> allocations(0);
+
+/**
+@brief Allocazione e rilascio usati da tutte le versioni sostituite di operator new e delete
+
+Non inline: se il compilatore vedesse la coppia operator new / free segnalerebbe
+-Wmismatched-new-delete sulle delete del programma
+**/
+[[gnu::noinline]] static void *counted_allocate(std::size_t n, std::size_t align){
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void *p = align > alignof(std::max_align_t) ?
+		std::aligned_alloc(align, (n + align - 1) / align * align) : std::malloc(n ? n : 1);
+	if(!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+[[gnu::noinline]] static void counted_release(void *p) noexcept { std::free(p); }
+
+void *operator new(std::size_t n){ return counted_allocate(n, 0); }
+void *operator new(std::size_t n, std::align_val_t al){ return counted_allocate(n, static_cast<std::size_t>(al)); }
+
+void operator delete(void *p) noexcept { counted_release(p); }
+void operator delete(void *p, std::size_t) noexcept { counted_release(p); }
+void operator delete(void *p, std::align_val_t) noexcept { counted_release(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { counted_release(p); }
 
 void test_constructors(){
     cbuffer<int> a(3, 0);
@@ -29,13 +91,96 @@ void test_constructors(){
 }
 
 void test_insert(){
-    cbuffer<int> cb(3);
+    cbuffer<int, cbuffer_logging_policy> cb(3);
     for(int i = 0; i < 3; i++)
         cb.insert(i);
     std::cout << cb << std::endl;
     for(int i = 3; i < 5; i++)
         cb.insert(i);
     std::cout << cb << std::endl;
+    cbuffer<int, cbuffer_logging_policy> zero(0);
+    zero.insert(1);
+    zero.remove();
+}
+
+/**
+@brief Tipo senza operator<<, usato per verificare che cbuffer non lo richieda
+**/
+struct no_stream {
+	int value;
+};
+
+void test_policies(){
+	cbuffer<int> cb(2);
+	std::cout << "insert 1: " << cb.insert(1) << std::endl;
+	std::cout << "insert 2: " << cb.insert(2) << std::endl;
+	std::cout << "insert 3 (overwrite): " << (cb.insert(3) == insert_overwritten) << std::endl;
+	cbuffer<int> zero(0);
+	std::cout << "insert on size 0 rejected: " << (zero.insert(1) == insert_rejected) << std::endl;
+	std::cout << "remove on empty: " << zero.remove() << std::endl;
+
+	cbuffer<int, cbuffer_counting_policy> counted(2);
+	for(int i = 0; i < 5; i++)
+		counted.insert(i);
+	for(int i = 0; i < 3; i++)
+		counted.remove();
+	const cbuffer_counting_policy &c = counted.policy();
+	std::cout << "inserts: " << c.inserts << ", overwrites: " << c.overwrites
+		<< ", removes: " << c.removes << ", rejects: " << c.rejects << std::endl;
+
+	cbuffer<no_stream> ns(2);
+	no_stream v = {7};
+	ns.insert(v);
+	std::cout << "cbuffer<no_stream>[0]: " << ns[0].value << std::endl;
+}
+
+void test_stats(){
+	std::vector<int> data;
+	for(int i = 0; i < 10; i++)
+		data.push_back(i);
+	cbuffer<int, cbuffer_stats_policy<> > cb(4);
+	cb.insert(1);
+	cb.insert(2);
+	cb.insert(data.begin(), data.begin() + 5);
+	cb.remove(3);
+	cb.pop();
+	cb.remove(5);
+	cb.remove();
+	cbuffer_stats s = cb.stats();
+	std::cout << s << std::endl;
+	std::cout << s.json() << std::endl;
+
+	cbuffer<int, cbuffer_stats_policy<> > copy(cb);
+	cb.policy().reset_stats();
+	std::cout << "after reset: " << cb.stats().inserts << " inserts, copy keeps " << copy.stats().inserts << std::endl;
+
+	cbuffer<int, cbuffer_stats_policy<true> > timed(3);
+	std::cout << "empty oldest: " << timed.stats().oldest << std::endl;
+	timed.insert(1);
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	timed.insert(2);
+	cbuffer_stats t = timed.stats();
+	std::cout << "oldest before newest: " << (t.oldest < t.newest) << ", oldest age >= 5ms: " << (t.oldest_age() >= 0.005) << std::endl;
+	timed.insert(data.begin(), data.begin() + 2);
+	long long newest = timed.stats().newest;
+	timed.remove(2);
+	t = timed.stats();
+	std::cout << "after overwrite and remove oldest == newest: " << (t.oldest == newest && t.newest == newest) << std::endl;
+	timed.remove();
+	std::cout << "drained oldest: " << timed.stats().oldest << ", age: " << timed.stats().oldest_age() << std::endl;
+
+	static_assert(std::is_nothrow_move_constructible_v<cbuffer_stats_policy<true> >);
+	static_assert(std::is_nothrow_swappable_v<cbuffer_stats_policy<true> >);
+	cbuffer<int, cbuffer_stats_policy<true> > other(3);
+	for(int i = 0; i < 5; i++)
+		other.insert(i);
+	timed.swap(other);
+	std::cout << "after swap: " << timed.stats().inserts << " inserts, oldest set " << (timed.stats().oldest != 0)
+		<< ", other oldest " << other.stats().oldest << std::endl;
+	cbuffer<int, cbuffer_stats_policy<true> > moved(std::move(timed));
+	moved.remove(3);
+	std::cout << "after move and remove(3): oldest " << moved.stats().oldest << ", moved-from oldest "
+		<< timed.stats().oldest << std::endl;
 }
 
 void test_empty(){
@@ -203,6 +348,54 @@ void test_const_iterators(){
 	std::cout << "begin <= end:" << (begin <= end) << std::endl; 
 }
 
+void test_wrap(){
+	cbuffer<int> cb(4);
+	for(int i = 0; i < 10; i++)
+        cb.insert(i);
+	cb.remove();
+	cb.insert(10);
+	std::cout << "Wrapped cbuffer: " << cb << std::endl;
+	for(int i = 0; i < 4; i++)
+        std::cout << "cb[" << i << "]: " << cb[i] << std::endl;
+	cbuffer<int>::const_iterator begin = cb.begin();
+	cbuffer<int>::const_iterator end = cb.end();
+	std::cout << "(end - begin): " << (end - begin) << std::endl;
+	for(; begin != end; ++begin)
+		std::cout << *begin << " ";
+	std::cout << std::endl;
+	cbuffer<int> copy(cb);
+	std::cout << "Copy of wrapped cbuffer: " << copy << std::endl;
+
+	static_assert(std::random_access_iterator<cbuffer<int>::iterator>);
+	static_assert(std::random_access_iterator<cbuffer<int>::const_iterator>);
+	static_assert(std::ranges::random_access_range<cbuffer<int> >);
+	static_assert(std::ranges::sized_range<const cbuffer<int> >);
+	cbuffer<int>::iterator it = cb.begin();
+	cbuffer<int>::iterator moved = it + 3;
+	std::cout << "it + 3 leaves it: " << *it << ", " << *moved << ", 1 + it: " << *(1 + it)
+		<< ", begin - end: " << (cb.begin() - cb.end()) << std::endl;
+	std::cout << "reverse:";
+	for(cbuffer<int>::const_reverse_iterator r = cb.crbegin(); r != cb.crend(); ++r)
+		std::cout << " " << *r;
+	std::cout << std::endl;
+	std::cout << "segments:";
+	for_each_segment(cb.cbegin(), cb.cend(), [](std::span<const int> run){
+		std::cout << " {";
+		for(std::size_t i = 0; i < run.size(); i++)
+			std::cout << (i ? " " : "") << run[i];
+		std::cout << "}";
+	});
+	std::cout << std::endl;
+	int out[4];
+	copy_segmented(cb.begin() + 1, cb.end(), out);
+	std::cout << "copy_segmented from 1: " << out[0] << out[1] << out[2]
+		<< ", find_segmented(10) at " << (find_segmented(cb.begin(), cb.end(), 10) - cb.begin())
+		<< ", find_segmented(42) is end: " << (find_segmented(cb.begin(), cb.end(), 42) == cb.end()) << std::endl;
+	std::ranges::sort(cb, std::greater<int>());
+	std::cout << "ranges::sort descending: " << cb << ", ranges::find(8) at "
+		<< (std::ranges::find(cb, 8) - cb.begin()) << std::endl;
+}
+
 void test_voce(){
 	cbuffer<voce> cb(2);
 	cb.insert(voce("Rossi","Luca", "5558372"));
@@ -212,9 +405,1152 @@ void test_voce(){
 	std::cout << cb << std::endl;
 }
 
+static_assert(!std::is_copy_constructible_v<spsc_cbuffer<int> > && !std::is_copy_assignable_v<spsc_cbuffer<int> >,
+	"spsc_cbuffer is not copyable");
+static_assert(!std::is_copy_constructible_v<mpmc_cbuffer<int> > && !std::is_copy_assignable_v<mpmc_cbuffer<int> >,
+	"mpmc_cbuffer is not copyable");
+
+void test_spsc(){
+	spsc_cbuffer<int> cb(1000);
+	std::cout << "spsc_cbuffer size: " << cb.size() << std::endl;
+	const int n = 1000000;
+	long long sum = 0;
+	bool ordered = true;
+	std::thread producer([&cb, n](){
+		for(int i = 0; i < n; ){
+			int batch[7];
+			int k = 0;
+			for(; k < 7 && i + k < n; ++k)
+				batch[k] = i + k;
+			std::size_t pushed = 0;
+			if(k > 1)
+				pushed = cb.try_push_bulk(batch, k);
+			else if(cb.try_push(i))
+				pushed = 1;
+			if(pushed == 0)
+				std::this_thread::yield();
+			i += (int)pushed;
+		}
+	});
+	std::thread consumer([&cb, &sum, &ordered, n](){
+		int expected = 0;
+		int out[5];
+		while(expected < n){
+			std::size_t got = cb.try_pop_bulk(out, 5);
+			if(got == 0){
+				int value;
+				if(cb.try_pop(value))
+					out[got++] = value;
+				else
+					std::this_thread::yield();
+			}
+			for(std::size_t k = 0; k < got; ++k){
+				if(out[k] != expected)
+					ordered = false;
+				sum += out[k];
+				++expected;
+			}
+		}
+	});
+	producer.join();
+	consumer.join();
+	std::cout << "SPSC stress ordered: " << ordered << ", sum: " << sum
+		<< " (expected " << (long long)n * (n - 1) / 2 << ")" << std::endl;
+	std::cout << "Empty after stress: " << cb.empty() << std::endl;
+}
+
+void test_mpmc(){
+	mpmc_cbuffer<int> rej(4);
+	int accepted = 0;
+	for(int i = 0; i < 6; i++)
+		accepted += rej.try_push(i);
+	std::cout << "mpmc_cbuffer reject: accepted " << accepted << " of 6" << std::endl;
+
+	mpmc_cbuffer<int> ow(4, overflow_overwrite);
+	for(int i = 0; i < 10; i++)
+		ow.push(i);
+	std::cout << "mpmc_cbuffer overwrite, dropped " << ow.dropped() << ":";
+	int value;
+	while(ow.try_pop(value))
+		std::cout << " " << value;
+	std::cout << std::endl;
+
+	// overwrite concorrente: ogni elemento è consumato, scartato o ancora nel buffer, una volta sola
+	mpmc_cbuffer<int> lossy(8, overflow_overwrite);
+	std::atomic<long long> taken(0);
+	std::atomic<bool> writing(true);
+	std::vector<std::thread> ow_threads;
+	for(int p = 0; p < 2; p++)
+		ow_threads.push_back(std::thread([&lossy](){
+			for(int i = 0; i < 50000; i++)
+				lossy.push(i);
+		}));
+	std::thread reader([&](){
+		int v;
+		for(bool more = true; more; ){
+			more = writing.load();
+			while(lossy.try_pop(v))
+				taken.fetch_add(1);
+		}
+	});
+	for(std::size_t t = 0; t < ow_threads.size(); t++)
+		ow_threads[t].join();
+	writing.store(false);
+	reader.join();
+	std::cout << "mpmc_cbuffer concurrent overwrite: consumed + dropped == pushed: "
+		<< (taken.load() + (long long)lossy.dropped() == 100000) << std::endl;
+
+	mpmc_cbuffer<int> cb(64, overflow_spin);
+	const int producers = 4, consumers = 3, n = 100000;
+	std::atomic<long long> sum(0);
+	std::atomic<int> consumed(0);
+	std::vector<std::thread> threads;
+	for(int p = 0; p < producers; ++p)
+		threads.push_back(std::thread([&cb, n](){
+			for(int i = 1; i <= n; ++i)
+				cb.push(i);
+		}));
+	for(int c = 0; c < consumers; ++c)
+		threads.push_back(std::thread([&cb, &sum, &consumed, producers, n](){
+			int v;
+			while(consumed.load() < producers * n){
+				if(cb.try_pop(v)){
+					sum += v;
+					++consumed;
+				}else
+					std::this_thread::yield();
+			}
+		}));
+	for(std::size_t t = 0; t < threads.size(); ++t)
+		threads[t].join();
+	std::cout << "MPMC stress consumed: " << consumed.load() << ", sum: " << sum.load()
+		<< " (expected " << (long long)producers * n * (n + 1) / 2 << ")" << std::endl;
+}
+
+void test_blocking(){
+	blocking_cbuffer<int> cb(3);
+	for(int i = 0; i < 3; i++)
+		cb.push(i);
+	std::cout << "blocking_cbuffer try_push on full: " << cb.try_push(9) << std::endl;
+	std::cout << "blocking_cbuffer push with timeout on full: "
+		<< (cb.push(9, std::chrono::milliseconds(5)) == insert_rejected ? "rejected" : "accepted") << std::endl;
+	std::cout << "blocking_cbuffer push_overwrite on full: "
+		<< (cb.push(3, push_overwrite) == insert_overwritten ? "overwritten" : "?") << std::endl;
+	int value;
+	std::cout << "blocking_cbuffer drain:";
+	while(cb.try_pop(value))
+		std::cout << " " << value;
+	std::cout << std::endl;
+	std::cout << "blocking_cbuffer pop_wait with timeout on empty: " << cb.pop_wait(value, std::chrono::milliseconds(5)) << std::endl;
+	std::cout << "blocking_cbuffer sleeps after two timeouts: " << cb.sleeps() << std::endl;
+
+	blocking_cbuffer<int> pipe(8);
+	const int producers = 3, consumers = 2, n = 20000;
+	std::atomic<long long> sum(0);
+	std::vector<std::thread> threads;
+	for(int p = 0; p < producers; ++p)
+		threads.push_back(std::thread([&pipe, n](){
+			for(int i = 1; i <= n; ++i)
+				pipe.push(i);
+		}));
+	for(int c = 0; c < consumers; ++c)
+		threads.push_back(std::thread([&pipe, &sum](){
+			int v;
+			while(pipe.pop_wait(v) && v != 0)
+				sum += v;
+		}));
+	for(int p = 0; p < producers; ++p)
+		threads[p].join();
+	for(int c = 0; c < consumers; ++c)
+		pipe.push(0);
+	for(std::size_t t = producers; t < threads.size(); ++t)
+		threads[t].join();
+	std::cout << "blocking_cbuffer stress sum: " << sum.load()
+		<< " (expected " << (long long)producers * n * (n + 1) / 2 << ")" << std::endl;
+
+	blocking_cbuffer<int> late(1);
+	std::thread waker([&late](){
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		late.push(42);
+	});
+	bool got = late.pop_wait(value, std::chrono::seconds(5));
+	waker.join();
+	std::cout << "blocking_cbuffer pop_wait woken by push: " << got << " " << value << std::endl;
+}
+
+cbuffer_task async_produce(async_cbuffer<int> &out, int n, std::vector<std::string> &log){
+	for(int i = 1; i <= n; ++i){
+		co_await out.push(i);
+		log.push_back("push " + std::to_string(i));
+	}
+	out.close();
+}
+
+cbuffer_task async_square(async_cbuffer<int> &in, async_cbuffer<int> &out){
+	while(std::optional<int> v = co_await in.pop())
+		co_await out.push(*v * *v);
+	out.close();
+}
+
+cbuffer_task async_consume(async_cbuffer<int> &in, long long &sum, std::vector<std::string> &log){
+	while(std::optional<int> v = co_await in.pop()){
+		sum += *v;
+		log.push_back("pop " + std::to_string(*v));
+	}
+	log.push_back("closed");
+}
+
+cbuffer_task async_throw(async_cbuffer<int> &in){
+	co_await in.pop();
+	throw std::runtime_error("stage failed");
+}
+
+void test_async(){
+	cbuffer_executor ex;
+	async_cbuffer<int> numbers(ex, 4), squares(ex, 2);
+	long long sum = 0;
+	std::vector<std::string> log;
+	ex.spawn(async_produce(numbers, 100, log));
+	ex.spawn(async_square(numbers, squares));
+	ex.spawn(async_consume(squares, sum, log));
+	ex.run();
+	std::cout << "async_cbuffer pipeline sum of squares 1..100: " << sum << ", pending " << ex.pending() << std::endl;
+
+	// il consumatore in attesa viene ripreso prima che il produttore continui
+	async_cbuffer<int> direct(ex, 1);
+	std::vector<std::string> order;
+	long long ignored = 0;
+	ex.spawn(async_consume(direct, ignored, order));
+	ex.run();
+	ex.spawn(async_produce(direct, 3, order));
+	ex.run();
+	std::cout << "async_cbuffer handoff order:";
+	for(std::size_t i = 0; i < order.size(); ++i)
+		std::cout << " [" << order[i] << "]";
+	std::cout << std::endl;
+
+	async_cbuffer<int> rendezvous(ex, 0);
+	std::vector<std::string> unused;
+	long long rsum = 0;
+	ex.spawn(async_produce(rendezvous, 10, unused));
+	ex.spawn(async_consume(rendezvous, rsum, unused));
+	ex.run();
+	std::cout << "async_cbuffer capacity 0 sum: " << rsum << std::endl;
+
+	async_cbuffer<int> idle(ex, 2);
+	long long isum = 0;
+	std::vector<std::string> ilog;
+	std::size_t waiting = ex.spawn(async_consume(idle, isum, ilog));
+	ex.run();
+	std::cout << "async_cbuffer cancel waiting consumer: waiting " << idle.waiting();
+	std::cout << ", cancel " << ex.cancel(waiting) << ", waiting " << idle.waiting()
+		<< ", done " << ex.done(waiting) << ", cancel again " << ex.cancel(waiting) << std::endl;
+	std::cout << "async_cbuffer try_push after cancel: " << idle.try_push(7) << idle.try_push(8) << idle.try_push(9)
+		<< ", try_pop " << idle.try_pop().value_or(-1) << std::endl;
+
+	async_cbuffer<int> blocked(ex, 1);
+	std::vector<std::string> blog;
+	std::size_t producer = ex.spawn(async_produce(blocked, 5, blog));
+	ex.run();
+	std::cout << "async_cbuffer producer blocked after " << blog.size() << " pushes, waiting " << blocked.waiting();
+	ex.cancel(producer);
+	std::cout << ", after cancel " << blocked.waiting() << std::endl;
+
+	async_cbuffer<int> failing(ex, 1);
+	ex.spawn(async_throw(failing));
+	ex.run();
+	failing.try_push(1);
+	try{
+		ex.run();
+	}catch(std::runtime_error &e){
+		std::cout << "async_cbuffer exception from task: " << e.what() << std::endl;
+	}
+
+	{
+		cbuffer_executor local;
+		async_cbuffer<int> *orphan = new async_cbuffer<int>(local, 1);
+		long long osum = 0;
+		std::vector<std::string> olog;
+		local.spawn(async_consume(*orphan, osum, olog));
+		local.run();
+		delete orphan;
+	}
+	std::cout << "async_cbuffer destroyed before its waiting task: ok" << std::endl;
+}
+
+/**
+@brief Tipo senza costruttore di default che conta le istanze vive
+**/
+struct tracked {
+	static int alive;
+	int value;
+	explicit tracked(int v): value(v) { ++alive; }
+	tracked(const tracked &other): value(other.value) { ++alive; }
+	tracked &operator=(const tracked &other) { value = other.value; return *this; }
+	~tracked() { --alive; }
+};
+
+int tracked::alive = 0;
+
+void test_emplace(){
+	{
+		cbuffer<tracked> cb(3);
+		std::cout << "Alive after construction: " << tracked::alive << std::endl;
+		for(int i = 0; i < 5; i++)
+			cb.emplace(i);
+		std::cout << "Alive after 5 emplace in size 3: " << tracked::alive << std::endl;
+		cb.remove();
+		std::cout << "Alive after remove: " << tracked::alive << std::endl;
+		cb.insert(cb[0]);
+		std::cout << "cb[1] after insert(cb[0]): " << cb[1].value << std::endl;
+		cbuffer<tracked> copy(cb);
+		std::cout << "Alive after copy: " << tracked::alive << std::endl;
+	}
+	std::cout << "Alive after destruction: " << tracked::alive << std::endl;
+
+	cbuffer<voce> rubrica(2);
+	rubrica.emplace("Rossi", "Luca", "5558372");
+	rubrica.emplace("Bianchi", "Paolo", "5558373");
+	rubrica.emplace("Verdi", "Giovanni", "5558374");
+	std::cout << rubrica << std::endl;
+}
+
+void test_move(){
+	cbuffer<int> a(3);
+	for(int i = 0; i < 4; i++)
+		a.insert(i);
+	cbuffer<int> b(std::move(a));
+	std::cout << "Moved-to: " << b << ", moved-from size: " << a.size() << std::endl;
+	cbuffer<int> c;
+	c = std::move(b);
+	std::cout << "Move assigned: " << c << std::endl;
+	std::cout << "pop: " << c.pop() << ", after: " << c << std::endl;
+	swap(a, c);
+	std::cout << "After swap a: " << a << ", c: " << c << std::endl;
+	try{
+		c.pop();
+	}catch(std::out_of_range &){
+		std::cout << "Pop from empty cbuffer" << std::endl;
+	}
+}
+
+/**
+@brief Crea una voce con stringhe più lunghe del small string buffer
+**/
+voce long_voce(int i){
+	return voce("Cognome-molto-lungo-" + std::to_string(i),
+		"Nome-piuttosto-lungo-" + std::to_string(i), "+39-0000-555-000-" + std::to_string(i));
+}
+
+/**
+@brief Crea e riempie un cbuffer<voce>, restituito per valore
+**/
+cbuffer<voce> make_rubrica(int size){
+	cbuffer<voce> cb(size);
+	for(int i = 0; i < size; i++)
+		cb.insert(long_voce(i));
+	return cb;
+}
+
+/**
+@brief Allocazioni e tempi con copia e con spostamento per cbuffer<voce>
+
+Per ogni scenario stampa il numero di allocazioni dinamiche per operazione e il tempo totale
+**/
+void test_move_allocations(){
+	const int n = 20000;
+	typedef std::chrono::steady_clock clock;
+	std::vector<voce> source;
+	for(int i = 0; i < n; i++)
+		source.push_back(long_voce(i));
+
+	cbuffer<voce> cb(1024);
+	std::size_t before = allocations;
+	clock::time_point start = clock::now();
+	for(int i = 0; i < n; i++)
+		cb.insert(source[i]);
+	double copy_secs = std::chrono::duration<double>(clock::now() - start).count();
+	std::size_t copy_allocs = allocations - before;
+
+	std::vector<voce> moved(source);
+	before = allocations;
+	start = clock::now();
+	for(int i = 0; i < n; i++)
+		cb.insert(std::move(moved[i]));
+	double move_secs = std::chrono::duration<double>(clock::now() - start).count();
+	std::size_t move_allocs = allocations - before;
+	std::cout << "insert(const voce&): " << (double)copy_allocs / n << " allocs/op, " << copy_secs << " s" << std::endl;
+	std::cout << "insert(voce&&):      " << (double)move_allocs / n << " allocs/op, " << move_secs << " s" << std::endl;
+
+	cbuffer<voce> target;
+	cbuffer<voce> filled = make_rubrica(1024);
+	before = allocations;
+	target = static_cast<const cbuffer<voce> &>(filled);
+	std::cout << "copy assign 1024 voci: " << allocations - before << " allocs" << std::endl;
+	before = allocations;
+	target = make_rubrica(1024);
+	std::size_t build = allocations - before;
+	before = allocations;
+	target = std::move(filled);
+	std::cout << "move assign 1024 voci: " << allocations - before << " allocs (building the temporary: "
+		<< build << ")" << std::endl;
+
+	before = allocations;
+	std::size_t total = 0;
+	while(!target.empty()){
+		voce v = target[0];
+		total += v.ntel.size();
+		target.remove();
+	}
+	std::cout << "cb[0] + remove on 1024 voci: " << allocations - before << " allocs" << std::endl;
+	target = make_rubrica(1024);
+	before = allocations;
+	while(!target.empty())
+		total += target.pop().ntel.size();
+	std::cout << "pop on 1024 voci: " << allocations - before << " allocs" << std::endl;
+}
+
+/**
+@brief Simula una richiesta che usa un cbuffer<voce> di breve durata
+**/
+template <typename Buffer>
+std::size_t handle_request(Buffer &history, int i){
+	history.emplace("Rossi", "Luca", "555");
+	history.emplace("Bianchi", "Paolo", "556");
+	history.insert(voce("Verdi", "Gio", "557"));
+	return history[i % 3].ntel.size();
+}
+
+void test_allocators(){
+	const int requests = 1000;
+	std::size_t total = 0;
+
+	std::size_t before = allocations;
+	for(int i = 0; i < requests; i++){
+		cbuffer<voce> history(64);
+		total += handle_request(history, i);
+	}
+	std::cout << "std::allocator: " << allocations - before << " global allocations for "
+		<< requests << " requests" << std::endl;
+
+	cbuffer_arena &arena = cbuffer_thread_arena();
+	before = allocations;
+	for(int i = 0; i < requests; i++){
+		pmr_cbuffer<voce> history(64, &arena);
+		total += handle_request(history, i);
+	}
+	std::cout << "cbuffer_arena: " << allocations - before << " global allocations, "
+		<< arena.used() << " bytes in use after the requests" << std::endl;
+
+	cbuffer_arena fifo(4 * cbuffer_pool::block_for<voce>(64));
+	for(int i = 0; i < requests; i++){
+		std::optional<pmr_cbuffer<voce>> first(std::in_place, 64, &fifo);
+		pmr_cbuffer<voce> second(64, &fifo);
+		total += handle_request(*first, i) + handle_request(second, i);
+		first.reset();
+	}
+	std::cout << "cbuffer_arena out of order: " << fifo.upstream_allocations()
+		<< " upstream allocations, " << fifo.used() << " bytes in use" << std::endl;
+
+	cbuffer_pool pool(cbuffer_pool::block_for<voce>(64), 4);
+	before = allocations;
+	for(int i = 0; i < requests; i++){
+		pmr_cbuffer<voce> a(64, &pool);
+		pmr_cbuffer<voce> b(64, &pool);
+		total += handle_request(a, i) + handle_request(b, i);
+	}
+	std::cout << "cbuffer_pool: " << allocations - before << " global allocations" << std::endl;
+
+	pmr_cbuffer<voce> x(2, &arena);
+	x.emplace("Rossi", "Luca", "555");
+	pmr_cbuffer<voce> y(x);
+	pmr_cbuffer<voce> z(4, &pool);
+	z = std::move(x);
+	std::cout << "Copy keeps default resource: " << (y.get_allocator().resource() != &arena)
+		<< ", move assign across resources: " << z << " (pool: "
+		<< (z.get_allocator().resource() == &pool) << ")" << std::endl;
+	(void)total;
+}
+
+/**
+@brief Somma degli ultimi 4 di 10 valori calcolata in compilazione
+**/
+constexpr int static_last_sum(){
+	static_cbuffer<int, 4> cb;
+	for(int i = 0; i < 10; i++)
+		cb.insert(i);
+	cb.remove();
+	cb.insert(10);
+	int sum = 0;
+	for(static_cbuffer<int, 4>::const_iterator it = cb.begin(); it != cb.end(); ++it)
+		sum += *it;
+	return sum + cb[0] * 100;
+}
+
+static_assert(static_last_sum() == 7 + 8 + 9 + 10 + 700, "static_cbuffer constexpr");
+static_assert(sizeof(static_cbuffer<int, 8>) == 8 * sizeof(int) + 2 * sizeof(int), "inline storage");
+static_assert(std::random_access_iterator<static_cbuffer<int, 4>::iterator>, "static_cbuffer iterator");
+static_assert(std::random_access_iterator<static_cbuffer<int, 4>::const_iterator>, "static_cbuffer const_iterator");
+static_assert(std::ranges::random_access_range<static_cbuffer<int, 4> >, "static_cbuffer range");
+
+void test_static_cbuffer(){
+	std::size_t before = allocations;
+	static_cbuffer<int, 3> pow3;
+	static_cbuffer<int, 4> pow2;
+	for(int i = 0; i < 5; i++){
+		pow3.insert(i);
+		pow2.insert(i);
+	}
+	std::cout << "static_cbuffer<int, 3>: " << pow3 << ", <int, 4>: " << pow2 << std::endl;
+	std::cout << "pop: " << pow2.pop() << ", pow2[0]: " << pow2[0] << std::endl;
+	static_cbuffer<voce, 2> rubrica;
+	rubrica.emplace("Rossi", "Luca", "555");
+	rubrica.emplace("Bianchi", "Paolo", "556");
+	rubrica.emplace("Verdi", "Gio", "557");
+	std::cout << rubrica << std::endl;
+	static_cbuffer<int, 0> zero;
+	std::cout << "insert on N = 0 rejected: " << (zero.insert(1) == insert_rejected) << std::endl;
+	static_cbuffer<int, 4> copy(pow2);
+	swap(copy, pow2);
+	evaluate_if(copy, greater_zero());
+	std::cout << "Heap allocations: " << allocations - before << std::endl;
+	try{
+		std::cout << pow2[3] << std::endl;
+	}catch(std::out_of_range &){
+		std::cout << "Out of range on index: 3" << std::endl;
+	}
+	std::cout << "constexpr sum: " << static_last_sum() << std::endl;
+	static_cbuffer<int, 4> wrapped;
+	for(int i = 0; i < 6; i++)
+		wrapped.insert(5 - i);
+	std::ranges::sort(wrapped);
+	static_cbuffer<int, 4>::const_iterator cbegin = wrapped.begin();
+	std::cout << "ranges::sort across the wrap: " << wrapped << ", 2 + begin: " << *(2 + wrapped.begin())
+		<< ", begin == const begin: " << (wrapped.begin() == cbegin) << ", end - const begin: " << (wrapped.end() - cbegin) << std::endl;
+}
+
+void test_resize(){
+	cbuffer<int> cb(4);
+	for(int i = 0; i < 6; i++)
+		cb.insert(i);
+	cb.resize_capacity(8);
+	std::cout << "resize_capacity(8) of wrapped [2..5]: " << cb << ", size " << cb.size()
+		<< ", one contiguous run: " << (cb.array_two().size() == 0) << std::endl;
+	cb.insert(6);
+	cb.resize_capacity(3);
+	std::cout << "resize_capacity(3) keeps newest: " << cb << std::endl;
+	cb.reserve_capacity(2);
+	std::cout << "reserve_capacity(2) does not shrink, size: " << cb.size() << std::endl;
+	cb.resize_capacity(0);
+	std::cout << "resize_capacity(0): " << cb << ", insert " << (cb.insert(1) == insert_rejected ? "rejected" : "?") << std::endl;
+
+	cbuffer<int> grow(2);
+	grow.set_auto_grow(16);
+	std::size_t before = allocations.load();
+	int sizes = 0, last = 0;
+	for(int i = 0; i < 20; i++){
+		grow.insert(i);
+		if(grow.size() != last){
+			++sizes;
+			last = grow.size();
+		}
+	}
+	std::cout << "auto-grow 2 -> 16: size " << grow.size() << ", growths " << sizes - 1
+		<< ", allocations " << allocations.load() - before << ", first " << grow[0] << ", last " << grow[15] << std::endl;
+
+	cbuffer<voce> rubrica(1);
+	rubrica.set_auto_grow(4, 1.5);
+	rubrica.insert(voce("Rossi", "Luca", "5558372"));
+	rubrica.insert(rubrica[0]);
+	rubrica.emplace("Bianchi", "Paolo", "5558373");
+	std::cout << "auto-grow with insert(cb[0]): size " << rubrica.size() << std::endl << rubrica << std::endl;
+
+	cbuffer<int> burst(4);
+	burst.set_auto_grow(64);
+	std::vector<int> data(40);
+	for(int i = 0; i < 40; i++)
+		data[i] = i;
+	burst.insert(data.begin(), data.begin() + 3);
+	burst.insert(data.begin() + 3, data.end());
+	std::cout << "range insert with auto-grow: size " << burst.size() << ", elements "
+		<< burst.array_one().size() + burst.array_two().size() << ", last " << burst[39] << std::endl;
+
+	try{
+		burst.set_auto_grow(128, 1.0);
+	}catch(std::invalid_argument &e){
+		std::cout << "set_auto_grow factor 1: " << e.what() << std::endl;
+	}
+
+	{
+		cbuffer<tracked, cbuffer_counting_policy> live(3);
+		for(int i = 0; i < 5; i++)
+			live.emplace(i);
+		live.resize_capacity(2);
+		std::cout << "shrink with tracked: alive " << tracked::alive << ", removes " << live.policy().removes
+			<< ", front " << live[0].value << std::endl;
+		live.resize_capacity(10);
+		std::cout << "grow with tracked: alive " << tracked::alive << std::endl;
+	}
+	std::cout << "tracked alive after destruction: " << tracked::alive << std::endl;
+}
+
+void test_bulk(){
+	std::vector<int> data;
+	for(int i = 0; i < 10; i++)
+		data.push_back(i);
+	cbuffer<int, cbuffer_counting_policy> cb(4);
+	cb.insert(100);
+	cb.insert(101);
+	cb.remove();
+	std::cout << "insert 3 across the wrap: " << cb.insert(data.begin(), data.begin() + 3) << " -> " << cb << std::endl;
+	std::cout << "insert 10 into size 4: " << cb.insert(data.begin(), data.end()) << " -> " << cb << std::endl;
+	std::cout << "insert span: " << cb.insert(std::span<const int>(data.data(), 2)) << " -> " << cb << std::endl;
+	std::list<int> l(data.begin(), data.begin() + 3);
+	cb.insert(l.begin(), l.end());
+	std::cout << "insert from list: " << cb << std::endl;
+	std::istringstream is("7 8 9 10 11");
+	std::cout << "insert from istream: " << cb.insert(std::istream_iterator<int>(is), std::istream_iterator<int>())
+		<< " -> " << cb << std::endl;
+	std::cout << "remove(3): " << cb.remove(3) << " -> " << cb << std::endl;
+	std::cout << "remove(5): " << cb.remove(5) << " -> " << cb << std::endl;
+
+	int raw[4];
+	cb.insert(data.begin(), data.begin() + 7);
+	std::cout << "drain_into(raw, 3): " << cb.drain_into(raw, 3) << " -> " << raw[0] << raw[1] << raw[2]
+		<< ", left " << cb << std::endl;
+	std::vector<int> out;
+	cb.insert(data.begin(), data.begin() + 3);
+	std::cout << "drain_into(back_inserter, 10): " << cb.drain_into(std::back_inserter(out), 10) << " ->";
+	for(std::size_t i = 0; i < out.size(); i++)
+		std::cout << " " << out[i];
+	std::cout << ", left " << cb << std::endl;
+	const cbuffer_counting_policy &c = cb.policy();
+	unsigned long rejects = c.rejects;
+	std::cout << "drain_into on empty: " << cb.drain_into(raw, 2) << ", rejects +" << c.rejects - rejects << std::endl;
+	std::cout << "inserts: " << c.inserts << ", overwrites: " << c.overwrites
+		<< ", removes: " << c.removes << ", rejects: " << c.rejects << std::endl;
+
+	std::vector<voce> voci;
+	for(int i = 0; i < 5; i++)
+		voci.push_back(long_voce(i));
+	cbuffer<voce> rubrica(3);
+	rubrica.insert(voci.begin(), voci.end());
+	std::vector<voce> drained;
+	rubrica.drain_into(std::back_inserter(drained), 2);
+	std::cout << "voce drained: " << drained[0].cognome << ", " << drained[1].cognome
+		<< ", left " << rubrica << std::endl;
+	cbuffer<std::string> words(4);
+	const char *w[] = {"uno-abbastanza-lungo", "due-abbastanza-lungo", "tre-abbastanza-lungo", "quattro-abbastanza-lungo"};
+	for(int i = 0; i < 4; i++)
+		words.insert(w[i]);
+	words.remove();
+	words.insert("cinque-abbastanza-lungo");
+	words.insert(words.begin(), words.end());
+	std::cout << "insert of itself: " << words << std::endl;
+	words.insert(words.crbegin(), words.crbegin() + 2);
+	std::cout << "insert of its reversed newest 2: " << words << std::endl;
+	std::span<std::string> one = words.array_one();
+	words.insert(one.begin(), one.end());
+	std::cout << "insert of its array_one: " << words << std::endl;
+}
+
+void test_consume(){
+	cbuffer<int, cbuffer_counting_policy> cb(5);
+	for(int i = 0; i < 8; i++)
+		cb.insert(i);
+	std::cout << "front: " << cb.front() << ", back: " << cb.back() << ", at_unchecked(2): " << cb.at_unchecked(2) << std::endl;
+	cb.front() = 30;
+	std::cout << "front = 30: " << cb << std::endl;
+	std::cout << "for_each_batch(2):";
+	int batches = cb.for_each_batch(2, [](std::span<int> run){
+		std::cout << " {";
+		for(std::size_t i = 0; i < run.size(); i++)
+			std::cout << (i ? " " : "") << run[i];
+		std::cout << "}";
+	});
+	std::cout << " in " << batches << " batches" << std::endl;
+	int sum = 0, runs = 0;
+	std::cout << "consume(4): " << cb.consume(4, [&](std::span<int> run){
+		for(std::size_t i = 0; i < run.size(); i++)
+			sum += run[i];
+		++runs;
+	}) << " elements in " << runs << " runs, sum " << sum << ", left " << cb << std::endl;
+	std::cout << "consume(10): " << cb.consume(10, [](std::span<int>){}) << ", left " << cb << std::endl;
+	std::cout << "consume on empty: " << cb.consume(1, [](std::span<int>){}) << std::endl;
+	const cbuffer_counting_policy &c = cb.policy();
+	std::cout << "removes: " << c.removes << ", rejects: " << c.rejects << std::endl;
+	try{
+		cb.for_each_batch(0, [](std::span<int>){});
+	}catch(const std::invalid_argument &e){
+		std::cout << "for_each_batch(0): " << e.what() << std::endl;
+	}
+
+	cbuffer<voce> rubrica(3);
+	for(int i = 0; i < 4; i++)
+		rubrica.insert(long_voce(i));
+	std::vector<voce> taken;
+	rubrica.consume(2, [&](std::span<voce> run){
+		for(std::size_t i = 0; i < run.size(); i++)
+			taken.push_back(std::move(run[i]));
+	});
+	std::cout << "voce consumed: " << taken[0].cognome << ", " << taken[1].cognome << ", left " << rubrica << std::endl;
+	const cbuffer<voce> &crubrica = rubrica;
+	crubrica.for_each_batch(8, [](std::span<const voce> run){
+		std::cout << "const batch of " << run.size() << ": " << run[0].cognome << std::endl;
+	});
+	try{
+		rubrica.consume(1, [](std::span<voce>){ throw std::runtime_error("callback failed"); });
+	}catch(const std::runtime_error &){
+		std::cout << "after throwing callback: " << rubrica << std::endl;
+	}
+}
+
+void test_spans(){
+	cbuffer<char> cb(8);
+	const char *msg = "hello world!";
+	std::size_t written = 0;
+	while(written < 6){
+		std::span<char> slots = cb.reserve(6 - (int)written);
+		std::memcpy(slots.data(), msg + written, slots.size());
+		cb.commit((int)slots.size());
+		written += slots.size();
+	}
+	cb.remove(4);
+	written = 0;
+	while(written < 6){
+		std::span<char> slots = cb.reserve(6 - (int)written);
+		if(slots.empty())
+			break;
+		std::memcpy(slots.data(), msg + 6 + written, slots.size());
+		cb.commit((int)slots.size());
+		written += slots.size();
+	}
+	std::cout << "Full after reserve/commit: " << cb.full() << ", reserve on full: " << cb.reserve(1).size() << std::endl;
+	std::span<const char> one = static_cast<const cbuffer<char> &>(cb).array_one();
+	std::span<const char> two = static_cast<const cbuffer<char> &>(cb).array_two();
+	std::string joined(one.data(), one.size());
+	joined.append(two.data(), two.size());
+	std::cout << "array_one: " << one.size() << " bytes, array_two: " << two.size() << " bytes, content: "
+		<< joined << std::endl;
+	cbuffer<int> ints(4);
+	ints.insert(1);
+	std::cout << "Not wrapped: " << ints.array_one().size() << " + " << ints.array_two().size() << std::endl;
+}
+
+void test_algorithms(){
+	cbuffer<float> f(1000);
+	cbuffer<double> d(1000);
+	for(int i = 0; i < 1300; i++){
+		f.insert((float)((i * 37) % 101 - 50));
+		d.insert((double)((i * 37) % 101 - 50));
+	}
+	std::cout << "Wrapped: " << f.array_one().size() << " + " << f.array_two().size() << std::endl;
+	std::vector<std::uint64_t> expected((f.size() + 63) / 64), bits(expected.size());
+	mask_if(f, [](float x){ return x > 10; }, expected.data());
+	const char *names[] = {"scalar", "vec128", "avx2"};
+	for(int isa = cbuffer_isa_scalar; isa <= cbuffer_isa_avx2; isa++){
+		cbuffer_set_isa((cbuffer_isa)isa);
+		mask_if(f, greater_than<float>{10}, bits.data());
+		std::cout << names[isa] << " (" << names[cbuffer_get_isa()] << "): sum " << sum(f) << "/" << sum(d)
+			<< ", min " << min_value(f) << "/" << min_value(d) << ", max " << max_value(f) << "/" << max_value(d)
+			<< ", mean " << mean(d) << ", variance " << variance(f) << "/" << variance(d)
+			<< ", count > 10: " << count_if(f, greater_than<float>{10}) << "/" << count_if(d, greater_than<double>{10})
+			<< ", count < -10: " << count_if(f, less_than<float>{-10})
+			<< ", mask matches: " << (bits == expected) << std::endl;
+	}
+	cbuffer_set_isa(cbuffer_isa_avx2);
+
+	cbuffer<int> ints(4);
+	for(int i = 1; i <= 6; i++)
+		ints.insert(i);
+	mask_if(ints, greater_than<int>{4}, bits.data());
+	std::cout << ints << " sum " << sum(ints) << ", min " << min_value(ints) << ", max " << max_value(ints)
+		<< ", mean " << mean(ints) << ", variance " << variance(ints)
+		<< ", count odd: " << count_if(ints, [](int x){ return x % 2 == 1; })
+		<< ", mask > 4: " << bits[0] << std::endl;
+	cbuffer<double> empty(4);
+	try{
+		mean(empty);
+	}catch(const std::out_of_range &e){
+		std::cout << "mean of empty: " << e.what() << ", sum " << sum(empty) << std::endl;
+	}
+}
+
+void test_windowed(){
+	typedef windowed_cbuffer<double, window_count, window_sum<double>, window_mean<double>,
+		window_variance<double>, window_min<double>, window_max<double> > stats_buffer;
+	stats_buffer w(50);
+	int mismatches = 0;
+	unsigned long state = 1;
+	for(int i = 0; i < 1000; i++){
+		state = state * 6364136223846793005UL + 1442695040888963407UL;
+		double x = (double)((state >> 33) % 200) - 100;
+		if(i % 7 == 6)
+			w.remove();
+		else
+			w.insert(x);
+		if(w.empty())
+			continue;
+		const cbuffer<double> &cb = w.window();
+		if(w.aggregator<window_count>().count() != w.count()
+			|| std::abs(w.aggregator<window_sum<double> >().sum() - sum(cb)) > 1e-9
+			|| std::abs(w.aggregator<window_mean<double> >().mean() - mean(cb)) > 1e-9
+			|| std::abs(w.aggregator<window_variance<double> >().variance() - variance(cb)) > 1e-6
+			|| w.aggregator<window_min<double> >().min() != min_value(cb)
+			|| w.aggregator<window_max<double> >().max() != max_value(cb))
+			mismatches++;
+	}
+	std::cout << "windowed_cbuffer after 1000 steps: " << w.count() << " elements, mismatches: " << mismatches << std::endl;
+
+	windowed_cbuffer<int, window_min<int>, window_max<int>, window_mean<int> > ints(3);
+	int data[] = {5, 1, 1, 7, 3, 3, 9};
+	for(int i = 0; i < 7; i++){
+		ints.insert(data[i]);
+		std::cout << ints << " min " << ints.aggregator<window_min<int> >().min()
+			<< " max " << ints.aggregator<window_max<int> >().max()
+			<< " mean " << ints.aggregator<window_mean<int> >().mean() << std::endl;
+	}
+	ints.clear();
+	try{
+		ints.aggregator<window_min<int> >().min();
+	}catch(const std::out_of_range &e){
+		std::cout << "min after clear: " << e.what() << std::endl;
+	}
+}
+
+void test_filter(){
+	cbuffer<int> cb(5);
+	for(int i = -3; i <= 4; i++)
+		cb.insert(i);
+	std::vector<bool> flags(5);
+	evaluate_if_into(cb, greater_zero(), flags.begin());
+	std::cout << cb << " > 0:";
+	for(std::size_t i = 0; i < flags.size(); i++)
+		std::cout << " " << flags[i];
+	std::vector<int> odd = filter(cb, [](int x){ return x % 2 != 0; });
+	std::cout << ", odd at:";
+	for(std::size_t i = 0; i < odd.size(); i++)
+		std::cout << " " << odd[i];
+	std::cout << std::endl;
+
+	cbuffer<voce> rubrica(3000);
+	for(int i = 0; i < 4000; i++)
+		rubrica.insert(voce("Rossi", "Mario", (i % 3 ? "+39-" : "02-") + std::to_string(1000000 + i)));
+	std::regex mobile("\\+39-[0-9]+");
+	auto is_mobile = [&mobile](const voce &v){ return std::regex_match(v.ntel, mobile); };
+	std::vector<int> seq = filter(rubrica, is_mobile);
+	std::vector<int> par = filter(std::execution::par, rubrica, is_mobile);
+	std::vector<bool> seq_flags, par_flags;
+	evaluate_if_into(rubrica, is_mobile, std::back_inserter(seq_flags));
+	evaluate_if_into(std::execution::par, rubrica, is_mobile, std::back_inserter(par_flags));
+	std::cout << "mobile numbers: " << seq.size() << ", parallel filter matches: " << (seq == par)
+		<< ", parallel flags match: " << (seq_flags == par_flags) << ", first: " << rubrica[seq[0]].ntel << std::endl;
+	static_assert(!cbuffer_parallel::is_parallel<const std::execution::unsequenced_policy &>::value);
+	std::thread::id caller = std::this_thread::get_id();
+	bool other_thread = false;
+	filter(std::execution::unseq, rubrica, [&](const voce &v){
+		other_thread = other_thread || std::this_thread::get_id() != caller;
+		return is_mobile(v);
+	});
+	std::cout << "unseq filter stays on the calling thread: " << !other_thread << std::endl;
+	try{
+		filter(std::execution::par, rubrica, [](const voce &v) -> bool {
+			if(v.ntel == "+39-1003998")
+				throw std::runtime_error("bad number " + v.ntel);
+			return false;
+		});
+	}catch(const std::runtime_error &e){
+		std::cout << "Exception from the predicate: " << e.what() << std::endl;
+	}
+}
+
+void test_soa(){
+	soa_cbuffer<voce> rubrica(4);
+	rubrica.insert(voce("Rossi", "Luca", "02-555"));
+	rubrica.insert(voce("Bianchi", "Paolo", "+39-333"));
+	rubrica.emplace("Verdi", "Giovanni", "+39-347");
+	rubrica.insert(voce("Neri", "Anna", "06-111"));
+	std::cout << "insert on full: " << rubrica.insert(voce("Gialli", "Sara", "+39-320")) << " -> " << rubrica << std::endl;
+	int mobile = 0;
+	std::span<const std::string> one = static_cast<const soa_cbuffer<voce> &>(rubrica).array_one<voce_ntel>();
+	std::span<const std::string> two = static_cast<const soa_cbuffer<voce> &>(rubrica).array_two<voce_ntel>();
+	for(std::size_t i = 0; i < one.size(); i++)
+		mobile += one[i].compare(0, 4, "+39-") == 0;
+	for(std::size_t i = 0; i < two.size(); i++)
+		mobile += two[i].compare(0, 4, "+39-") == 0;
+	std::cout << "ntel column: " << one.size() << " + " << two.size() << ", mobile: " << mobile << std::endl;
+	rubrica[0].get<voce_nome>() = "Marco";
+	rubrica[1] = voce("Viola", "Elena", "+39-329");
+	voce first = rubrica[0];
+	std::cout << "first: " << first << ", after assign: " << rubrica << std::endl;
+	int n = 0;
+	for(soa_cbuffer<voce>::iterator it = rubrica.begin(); it != rubrica.end(); ++it)
+		n += (*it).get<voce_cognome>().size();
+	std::cout << "pop: " << rubrica.pop() << ", count: " << rubrica.count() << ", cognome letters: " << n << std::endl;
+	rubrica[0] = rubrica[1];
+	std::cout << "row 0 = row 1: " << rubrica << std::endl;
+	const soa_cbuffer<voce> &crubrica = rubrica;
+	rubrica[2] = crubrica[0];
+	rubrica[1] = rubrica[1];
+	std::cout << "row 2 = const row 0, row 1 = itself: " << rubrica << std::endl;
+
+	soa_cbuffer<std::tuple<int, double> > samples(3);
+	for(int i = 0; i < 5; i++)
+		samples.emplace(i, i * 0.5);
+	double total = 0;
+	for(std::size_t i = 0; i < samples.array_one<1>().size(); i++)
+		total += samples.array_one<1>()[i];
+	for(std::size_t i = 0; i < samples.array_two<1>().size(); i++)
+		total += samples.array_two<1>()[i];
+	std::tuple<int, double> oldest = samples[0];
+	std::cout << "tuple columns, oldest: " << std::get<0>(oldest) << ", sum of column 1: " << total << std::endl;
+}
+
+void test_compact_voce(){
+	const char *cognomi[] = {"Rossi", "Bianchi", "Verdi", "Esposito"};
+	const char *nomi[] = {"Luca", "Paolo", "Giovanni"};
+	std::vector<voce> source;
+	for(int i = 0; i < 1000; i++)
+		source.push_back(voce(cognomi[i % 4], nomi[i % 3], "+39-333-" + std::to_string(1000000 + i)));
+
+	voce_intern_table names;
+	cbuffer<compact_voce> rubrica(64);
+	for(int i = 0; i < 100; i++)
+		rubrica.insert(compact_voce(names, source[i]));
+	std::size_t before = allocations;
+	for(int i = 100; i < 1000; i++)
+		rubrica.insert(compact_voce(names, source[i]));
+	std::cout << "compact_voce: " << sizeof(compact_voce) << " bytes, " << allocations - before
+		<< " allocations for 900 inserts, interned: " << names.size() << ", newest: " << rubrica[63].view(names) << std::endl;
+	try{
+		compact_voce(names, "Rossi", "Luca", "+39-0000-0000-0000-0000-0000");
+	}catch(const std::length_error &e){
+		std::cout << e.what() << std::endl;
+	}
+
+	voce_ring ring(3, 80);
+	ring.insert(voce("Rossi", "Luca", "555-1"));
+	ring.insert(voce("Bianchi", "Paolo", "555-2"));
+	std::cout << "voce_ring: " << ring << ", " << ring.bytes_used() << " bytes" << std::endl;
+	ring.insert(voce("Cognome-molto-lungo", "Nome-piuttosto-lungo", "+39-0000-555-000"));
+	std::cout << "after a long voce: " << ring.count() << " voci, " << ring.bytes_used() << " bytes, oldest: " << ring[0] << std::endl;
+	for(int i = 0; i < 50; i++)
+		ring.insert(source[i]);
+	before = allocations;
+	for(int i = 50; i < 1000; i++)
+		ring.insert(source[i]);
+	std::cout << "voce_ring: " << allocations - before << " allocations for 950 inserts, " << ring << std::endl;
+	ring.remove();
+	std::cout << "after remove: " << ring << ", " << ring.bytes_used() << " bytes, as voce: " << ring[0].to_voce() << std::endl;
+}
+
+void test_indexed(){
+	indexed_cbuffer<voce, voce_ntel_key> recenti(3);
+	recenti.insert(voce("Rossi", "Luca", "555-1"));
+	recenti.insert(voce("Bianchi", "Paolo", "555-2"));
+	recenti.insert(voce("Rossi", "Luca", "555-1"));
+	std::cout << recenti << " find 555-1: " << recenti.find("555-1") << ", count: " << recenti.count("555-1")
+		<< ", contains 555-3: " << recenti.contains("555-3") << std::endl;
+	recenti.insert(voce("Verdi", "Giovanni", "555-3"));
+	recenti.insert(voce("Neri", "Anna", "555-4"));
+	std::vector<int> all = recenti.find_all("555-1");
+	std::cout << "after 2 overwrites: " << recenti << " 555-1 at " << all.size() << " position(s), first "
+		<< all[0] << ", 555-2 present: " << recenti.contains("555-2") << std::endl;
+	recenti.remove();
+	std::cout << "after remove: find 555-1: " << recenti.find("555-1") << ", find 555-4: " << recenti.find("555-4") << std::endl;
+
+	// confronto con la scansione lineare su molte operazioni con chiavi ripetute
+	indexed_cbuffer<voce, voce_cognome_key> rubrica(37);
+	int mismatches = 0;
+	unsigned long state = 7;
+	for(int i = 0; i < 5000; i++){
+		state = state * 6364136223846793005UL + 1442695040888963407UL;
+		std::string cognome = "C" + std::to_string((state >> 33) % 50);
+		if((state >> 40) % 5 == 0)
+			rubrica.remove();
+		else
+			rubrica.insert(voce(cognome, "N", std::to_string(i)));
+		std::string probe = "C" + std::to_string((state >> 20) % 50);
+		int last = -1, n = 0;
+		std::vector<int> positions;
+		for(int k = 0; k < rubrica.count(); k++)
+			if(rubrica[k].cognome == probe){
+				last = k;
+				n++;
+				positions.push_back(k);
+			}
+		if(rubrica.find(probe) != last || rubrica.count(probe) != n || rubrica.contains(probe) != (n > 0)
+				|| rubrica.find_all(probe) != positions)
+			mismatches++;
+	}
+	std::cout << "indexed_cbuffer vs linear scan after 5000 operations: mismatches " << mismatches << std::endl;
+
+	// chiavi intere consecutive con std::hash<int> (identità) e una sola chiave ripetuta
+	indexed_cbuffer<int, std::identity> numeri(1000);
+	for(int i = 0; i < 5000; i++)
+		numeri.insert(i);
+	std::cout << "int keys: find 4500 at " << numeri.find(4500) << ", contains 3999: " << numeri.contains(3999)
+		<< ", count 4999: " << numeri.count(4999) << std::endl;
+	indexed_cbuffer<int, std::identity> uguali(1000);
+	for(int i = 0; i < 5000; i++)
+		uguali.insert(7);
+	uguali.remove();
+	std::vector<int> sette = uguali.find_all(7);
+	std::cout << "one repeated key: count " << uguali.count(7) << ", find " << uguali.find(7) << ", find_all "
+		<< sette.size() << " from " << sette.front() << " to " << sette.back() << std::endl;
+}
+
+#ifdef __linux__
+void test_mirrored(){
+	mirrored_cbuffer cb(1000);
+	std::cout << "mirrored_cbuffer size: " << cb.size() << std::endl;
+	std::vector<char> data(cb.size() * 2);
+	for(std::size_t i = 0; i < data.size(); i++)
+		data[i] = (char)('a' + i % 26);
+	std::size_t first = cb.size() * 3 / 4;
+	cb.insert(data.data(), first);
+	cb.remove(first - 10);
+	std::size_t second = cb.insert(data.data() + first, cb.size());
+	std::span<const char> content = cb.contents();
+	std::cout << "Inserted across the end: " << second << ", content is one range of " << content.size()
+		<< " bytes, matches: " << (std::memcmp(content.data(), data.data() + first - 10, content.size()) == 0)
+		<< std::endl;
+	cb.remove(cb.count());
+
+	int in[2], out[2];
+	if(pipe(in) != 0 || pipe(out) != 0)
+		return;
+	const char msg[] = "through the pipe";
+	if(write(in[1], msg, sizeof(msg)) != (ssize_t)sizeof(msg))
+		return;
+	std::cout << "fill_from: " << cb.fill_from(in[0]) << ", drain_to: " << cb.drain_to(out[1]) << std::endl;
+	char back[sizeof(msg)];
+	if(read(out[0], back, sizeof(back)) == (ssize_t)sizeof(back))
+		std::cout << "Read back: " << back << std::endl;
+	cb.insert(data.data(), cb.size());
+	if(write(in[1], msg, sizeof(msg)) != (ssize_t)sizeof(msg))
+		return;
+	ssize_t full = cb.fill_from(in[0]);
+	bool nobufs = errno == ENOBUFS;
+	std::cout << "fill_from on full: " << full << ", ENOBUFS: " << nobufs
+		<< ", count: " << cb.count() << std::endl;
+	close(in[0]); close(in[1]); close(out[0]); close(out[1]);
+}
+
+void test_persistent(){
+	std::string path = "/tmp/cbuffer_test_" + std::to_string(getpid()) + ".ring";
+	unlink(path.c_str());
+	{
+		persistent_cbuffer<int> cb(path, 4);
+		for(int i = 0; i < 6; i++)
+			cb.insert(i);
+		std::cout << "persistent_cbuffer before close: " << cb << std::endl;
+	}
+	{
+		persistent_cbuffer<int> cb(path, 0);
+		std::cout << "persistent_cbuffer reopened: " << cb << ", size " << cb.size() << ", inserted " << cb.inserted() << std::endl;
+		cb.remove();
+		std::cout << "pop after reopen: " << cb.pop() << std::endl;
+	}
+	{
+		persistent_cbuffer<int> cb(path, 0);
+		std::cout << "persistent_cbuffer after remove and reopen: " << cb << std::endl;
+	}
+
+	// copia più recente di testa e coda rovinata: si riparte dalla precedente
+	int fd = open(path.c_str(), O_RDWR);
+	unsigned long long garbage = 0xdeadbeef;
+	bool corrupted = fd >= 0 && pwrite(fd, &garbage, sizeof(garbage), 40 + 24) == (ssize_t)sizeof(garbage);
+	{
+		persistent_cbuffer<int> cb(path, 0);
+		std::cout << "persistent_cbuffer after torn state (" << corrupted << "): " << cb << std::endl;
+	}
+	corrupted = fd >= 0 && pwrite(fd, &garbage, sizeof(garbage), 40 + 32 + 24) == (ssize_t)sizeof(garbage);
+	if(fd >= 0)
+		close(fd);
+	try{
+		persistent_cbuffer<int> cb(path, 0);
+	}catch(std::runtime_error &e){
+		std::cout << "persistent_cbuffer both states corrupted: " << e.what() << std::endl;
+	}
+	unlink(path.c_str());
+
+	{
+		persistent_cbuffer<int> cb(path, 8);
+	}
+	try{
+		persistent_cbuffer<double> cb(path, 0);
+	}catch(std::runtime_error &e){
+		std::cout << "persistent_cbuffer reopened with another type: " << e.what() << std::endl;
+	}
+	try{
+		persistent_cbuffer<int> cb(path, 16);
+	}catch(std::runtime_error &e){
+		std::cout << "persistent_cbuffer reopened with another capacity: " << e.what() << std::endl;
+	}
+	unlink(path.c_str());
+
+	// un file estraneo non viene reinizializzato, senza capacità non si crea nulla
+	fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	const char notes[] = "appunti da non perdere\n";
+	bool written = fd >= 0 && write(fd, notes, sizeof(notes) - 1) == (ssize_t)(sizeof(notes) - 1);
+	if(fd >= 0)
+		close(fd);
+	try{
+		persistent_cbuffer<int> cb(path, 4);
+	}catch(std::runtime_error &e){
+		struct stat st;
+		std::cout << "persistent_cbuffer on a foreign file (" << written << "): " << e.what()
+			<< ", size kept: " << (stat(path.c_str(), &st) == 0 && st.st_size == (off_t)(sizeof(notes) - 1)) << std::endl;
+	}
+	unlink(path.c_str());
+	try{
+		persistent_cbuffer<int> cb(path, 0);
+	}catch(std::runtime_error &e){
+		std::cout << "persistent_cbuffer without capacity: " << e.what()
+			<< ", file created: " << (access(path.c_str(), F_OK) == 0) << std::endl;
+	}
+	fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(fd >= 0)
+		close(fd);
+	{
+		persistent_cbuffer<int> cb(path, 2);
+		cb.insert(7);
+		std::cout << "persistent_cbuffer on an empty file: " << cb << std::endl;
+	}
+	unlink(path.c_str());
+
+	// un processo che muore senza distruttori non perde gli inserimenti
+	pid_t child = fork();
+	if(child == 0){
+		persistent_cbuffer<fixed_voce> rubrica(path, 3, sync_every_insert);
+		rubrica.insert(fixed_voce("Rossi", "Luca", "5558372"));
+		rubrica.insert(fixed_voce(voce("Bianchi", "Paolo", "5558373")));
+		rubrica.insert(fixed_voce("Verdi", "Anna", "5558374"));
+		rubrica.insert(fixed_voce("Neri", "Marta", "5558375"));
+		_exit(0);
+	}
+	int status = 0;
+	waitpid(child, &status, 0);
+	{
+		persistent_cbuffer<fixed_voce> rubrica(path, 3);
+		std::cout << "persistent_cbuffer<fixed_voce> after child exit: " << rubrica << std::endl;
+		std::cout << "to_voce: " << rubrica[0].to_voce() << std::endl;
+	}
+	unlink(path.c_str());
+	try{
+		fixed_voce v("Rossi", "Luca", "+39-0333-555-000000000000000000000000");
+	}catch(std::length_error &e){
+		std::cout << "fixed_voce too long: " << e.what() << std::endl;
+	}
+}
+#endif
+
 int main(){
     test_constructors();
     test_insert();
+    test_policies();
+    test_stats();
 	test_remove();
 	test_empty();
 	test_square_operator();
@@ -222,6 +1558,30 @@ int main(){
 	test_evaluate_if();
 	test_iterators();
 	test_const_iterators();
+	test_wrap();
 	test_voce();
+	test_emplace();
+	test_move();
+	test_move_allocations();
+	test_allocators();
+	test_static_cbuffer();
+	test_bulk();
+	test_consume();
+	test_resize();
+	test_spans();
+	test_algorithms();
+	test_windowed();
+	test_filter();
+	test_soa();
+	test_compact_voce();
+	test_indexed();
+#ifdef __linux__
+	test_mirrored();
+	test_persistent();
+#endif
+	test_spsc();
+	test_mpmc();
+	test_blocking();
+	test_async();
     return 0;
 }
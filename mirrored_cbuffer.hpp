@@ -0,0 +1,254 @@
+#ifndef MIRRORED_CBUFFER_H
+#define MIRRORED_CBUFFER_H
+
+#ifdef __linux__
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <system_error>
+
+/**
+@file mirrored_cbuffer.hpp
+@brief Dichiarazione della classe mirrored_cbuffer (solo Linux)
+**/
+
+/**
+@brief Buffer circolare di byte con memoria virtuale a specchio
+
+Le stesse pagine fisiche, create con memfd_create, sono mappate due volte una dopo l'altra:
+il byte in posizione size() + i è lo stesso del byte in posizione i. Così il contenuto e lo
+spazio libero sono sempre un unico intervallo contiguo, anche quando attraversano la fine
+del buffer, e parser, memcpy e le system call read/write lavorano direttamente sul buffer
+senza dividere i dati al punto di wrap.
+La capacità è arrotondata a un multiplo della dimensione di pagina; a differenza di cbuffer
+quando il buffer è pieno i nuovi byte vengono rifiutati invece di sovrascrivere i più vecchi.
+In caso di errore del sistema operativo i costruttori generano std::system_error
+**/
+class mirrored_cbuffer {
+    public:
+        typedef std::size_t size_type; ///< Definzione del tipo corrispondente alla dimensione del buffer
+    private:
+        char *_buffer; ///< Inizio della prima delle due mappature, lunghe _size byte ciascuna
+        size_type _size; ///< Capacità in byte, multiplo della pagina
+        size_type _start; ///< Offset del byte più vecchio, minore di _size
+        size_type _end; ///< Numero di byte presenti
+
+        mirrored_cbuffer(const mirrored_cbuffer &other) = delete;
+        mirrored_cbuffer &operator=(const mirrored_cbuffer &other) = delete;
+
+        static void fail(const char *what){
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+    public:
+        /**
+        @brief Costruttore con capacità
+
+        Crea il file anonimo in memoria e lo mappa due volte consecutive
+        @param size Capacità minima in byte, arrotondata al multiplo di pagina successivo
+        **/
+        explicit mirrored_cbuffer(size_type size): _buffer(0), _size(0), _start(0), _end(0){
+            size_type page = static_cast<size_type>(sysconf(_SC_PAGESIZE));
+            _size = (size == 0 ? 1 : (size + page - 1) / page) * page;
+
+            int fd = memfd_create("mirrored_cbuffer", MFD_CLOEXEC);
+            if(fd < 0)
+                fail("memfd_create");
+            if(ftruncate(fd, _size) != 0){
+                int err = errno;
+                close(fd);
+                errno = err;
+                fail("ftruncate");
+            }
+            // riserva lo spazio di indirizzamento per le due copie, poi le sovrappone
+            void *area = mmap(0, 2 * _size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(area == MAP_FAILED){
+                int err = errno;
+                close(fd);
+                errno = err;
+                fail("mmap");
+            }
+            char *base = static_cast<char *>(area);
+            if(mmap(base, _size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+               mmap(base + _size, _size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED){
+                int err = errno;
+                munmap(base, 2 * _size);
+                close(fd);
+                errno = err;
+                fail("mmap");
+            }
+            close(fd);
+            _buffer = base;
+        }
+
+        /**
+        @brief Distruttore
+
+        Rimuove entrambe le mappature, le pagine vengono liberate con l'ultima
+        **/
+        ~mirrored_cbuffer(){
+            if(_buffer)
+                munmap(_buffer, 2 * _size);
+        }
+
+        /**
+        @brief Capacità del buffer in byte
+        **/
+        size_type size() const {
+            return _size;
+        }
+
+        /**
+        @brief Numero di byte presenti
+        **/
+        size_type count() const {
+            return _end;
+        }
+
+        /**
+        @brief Controllo se il buffer è vuoto
+        **/
+        bool empty() const {
+            return _end == 0;
+        }
+
+        /**
+        @brief Controllo se il buffer è pieno
+        **/
+        bool full() const {
+            return _end == _size;
+        }
+
+        /**
+        @brief Contenuto del buffer
+
+        Tutti i byte presenti, dal più vecchio, come un unico intervallo contiguo
+        @return span sul contenuto
+        **/
+        std::span<const char> contents() const {
+            return std::span<const char>(_buffer + _start, _end);
+        }
+
+        /**
+        @brief Contenuto del buffer modificabile in posto
+        **/
+        std::span<char> contents() {
+            return std::span<char>(_buffer + _start, _end);
+        }
+
+        /**
+        @brief Prenotazione dello spazio libero
+
+        Ritorna tutto lo spazio libero in coda (al più n byte) come un unico intervallo
+        contiguo, da riempire e rendere visibile con commit
+        @param n Numero massimo di byte desiderati
+        @return span sullo spazio prenotato
+        **/
+        std::span<char> reserve(size_type n) {
+            size_type tail = _start + _end;
+            if(tail >= _size)
+                tail -= _size;
+            size_type free_bytes = _size - _end;
+            return std::span<char>(_buffer + tail, n < free_bytes ? n : free_bytes);
+        }
+
+        /**
+        @brief Pubblicazione dei byte scritti nello spazio prenotato
+
+        @pre n non supera la lunghezza dello span restituito da reserve
+        @param n Numero di byte scritti
+        **/
+        void commit(size_type n) {
+            _end += n;
+        }
+
+        /**
+        @brief Rimozione dei byte più vecchi
+
+        @param n Numero di byte da rimuovere
+        @return il numero di byte rimossi, minore di n se il buffer ne conteneva meno
+        **/
+        size_type remove(size_type n) {
+            if(n > _end)
+                n = _end;
+            _start += n;
+            if(_start >= _size)
+                _start -= _size;
+            _end -= n;
+            return n;
+        }
+
+        /**
+        @brief Inserimento di byte in coda
+
+        Copia con una sola memcpy quanti più byte di data entrano nello spazio libero
+        @param data Byte da inserire
+        @param n Numero di byte di data
+        @return il numero di byte inseriti
+        **/
+        size_type insert(const void *data, size_type n) {
+            std::span<char> slots = reserve(n);
+            std::memcpy(slots.data(), data, slots.size());
+            commit(slots.size());
+            return slots.size();
+        }
+
+        /**
+        @brief Estrazione dei byte più vecchi
+
+        Copia con una sola memcpy fino a n byte in out e li rimuove
+        @param out Destinazione dei byte
+        @param n Numero massimo di byte da estrarre
+        @return il numero di byte estratti
+        **/
+        size_type drain_into(void *out, size_type n) {
+            if(n > _end)
+                n = _end;
+            std::memcpy(out, _buffer + _start, n);
+            return remove(n);
+        }
+
+        /**
+        @brief Lettura da un file descriptor direttamente nello spazio libero
+
+        Esegue una sola read(2) su tutto lo spazio libero contiguo. Con il buffer pieno non legge
+        e restituisce -1 con errno a ENOBUFS, così 0 indica sempre la fine del file
+        @param fd File descriptor da cui leggere
+        @return il valore restituito da read: byte letti, 0 a fine file, -1 in caso di errore
+        **/
+        ssize_t fill_from(int fd) {
+            std::span<char> slots = reserve(_size);
+            if(slots.empty()){
+                errno = ENOBUFS;
+                return -1;
+            }
+            ssize_t got = read(fd, slots.data(), slots.size());
+            if(got > 0)
+                commit(static_cast<size_type>(got));
+            return got;
+        }
+
+        /**
+        @brief Scrittura del contenuto su un file descriptor
+
+        Esegue una sola write(2) su tutto il contenuto e rimuove i byte scritti
+        @param fd File descriptor su cui scrivere
+        @return il valore restituito da write: byte scritti o -1 in caso di errore
+        **/
+        ssize_t drain_to(int fd) {
+            if(_end == 0)
+                return 0;
+            ssize_t put = write(fd, _buffer + _start, _end);
+            if(put > 0)
+                remove(static_cast<size_type>(put));
+            return put;
+        }
+};
+
+#endif // __linux__
+
+#endif
@@ -0,0 +1,458 @@
+#ifndef PERSISTENT_CBUFFER_H
+#define PERSISTENT_CBUFFER_H
+
+#ifdef __linux__
+
+#include "cbuffer.hpp"
+#include "voce.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+/**
+@file persistent_cbuffer.hpp
+@brief Dichiarazione della classe persistent_cbuffer, buffer circolare su file mappato in memoria (solo Linux)
+**/
+
+#ifndef FIXED_VOCE_FIELD_SIZE
+/**
+@brief Caratteri massimi, terminatore escluso, di ogni campo di fixed_voce
+**/
+#define FIXED_VOCE_FIELD_SIZE 31
+#endif
+
+/**
+@brief voce a layout fisso, memorizzabile in un persistent_cbuffer
+
+I tre campi sono array di caratteri terminati da zero: la struct è trivially copyable
+e non contiene puntatori, quindi resta valida riaprendo il file in un altro processo
+**/
+struct fixed_voce {
+    char cognome[FIXED_VOCE_FIELD_SIZE + 1]; ///< cognome del contatto
+    char nome[FIXED_VOCE_FIELD_SIZE + 1]; ///< nome del contatto
+    char ntel[FIXED_VOCE_FIELD_SIZE + 1]; ///< numero telefonico del contatto
+
+    fixed_voce(){
+        cognome[0] = nome[0] = ntel[0] = 0;
+    }
+
+    /**
+    @brief Costruttore dai tre campi
+
+    Genera un eccezione length_error se un campo supera FIXED_VOCE_FIELD_SIZE caratteri
+    **/
+    fixed_voce(std::string_view c, std::string_view n, std::string_view t){
+        assign(cognome, c);
+        assign(nome, n);
+        assign(ntel, t);
+    }
+
+    explicit fixed_voce(const voce &v): fixed_voce(v.cognome, v.nome, v.ntel) {}
+
+    voce to_voce() const {
+        return voce(cognome, nome, ntel);
+    }
+
+    private:
+        static void assign(char (&field)[FIXED_VOCE_FIELD_SIZE + 1], std::string_view s){
+            if(s.size() > FIXED_VOCE_FIELD_SIZE)
+                throw std::length_error("fixed_voce field too long");
+            std::memcpy(field, s.data(), s.size());
+            std::memset(field + s.size(), 0, sizeof(field) - s.size());
+        }
+};
+
+/**
+@brief Operatore di stream, stesso formato di voce
+**/
+inline std::ostream &operator<<(std::ostream &os, const fixed_voce &v){
+    return os << v.cognome << " " << v.nome << " " << v.ntel;
+}
+
+/**
+@brief Quando persistent_cbuffer forza la scrittura su disco con msync
+
+- sync_never: lascia fare al sistema operativo; i dati sopravvivono al crash del processo
+- sync_every_n: msync dell'intero file ogni n inserimenti
+- sync_every_insert: msync dell'elemento e poi dell'intestazione a ogni inserimento e rimozione
+**/
+enum persistent_sync {
+    sync_never,
+    sync_every_n,
+    sync_every_insert
+};
+
+/**
+@brief Buffer circolare persistente su un file mappato in memoria
+
+Il file contiene un'intestazione, nella prima pagina, con capacità, dimensione degli elementi
+e un checksum della geometria, seguita dagli slot degli elementi. Testa e coda sono numeri
+di sequenza a 64 bit salvati in due copie alternate, ognuna con generazione e checksum:
+un aggiornamento scrive la copia inattiva, quindi un crash a metà lascia valida l'altra.
+Gli slot sono capacità + 1: un inserimento scrive sempre uno slot non occupato e diventa
+visibile solo con l'aggiornamento di testa e coda, anche quando sovrascrive il più vecchio.
+Riaprire il file costa O(1): gli elementi sono letti direttamente dalla mappatura, senza
+deserializzazione. T deve essere trivially copyable e senza puntatori, ad esempio fixed_voce.
+In caso di errore del sistema operativo i costruttori generano std::system_error,
+se il file non è compatibile o è corrotto std::runtime_error
+**/
+template <typename T>
+class persistent_cbuffer {
+    static_assert(std::is_trivially_copyable<T>::value, "persistent_cbuffer requires a trivially copyable type");
+
+    public:
+        typedef T value_type; ///< Definzione del tipo corrispondente al valore contenuto del buffer
+        typedef std::size_t size_type; ///< Definzione del tipo corrispondente alla dimensione
+
+    private:
+        static constexpr std::uint64_t magic = 0x3146504655424347ULL; ///< "GCBUFPF1"
+        static constexpr std::uint32_t version = 1;
+
+        /// Copia di testa e coda
+        struct state {
+            std::uint64_t generation;
+            std::uint64_t head; ///< Sequenza del più vecchio
+            std::uint64_t tail; ///< Sequenza del prossimo inserimento
+            std::uint64_t checksum;
+        };
+
+        /// Intestazione all'inizio del file
+        struct header {
+            std::uint64_t magic;
+            std::uint32_t version;
+            std::uint32_t element_size;
+            std::uint64_t capacity;
+            std::uint64_t data_offset; ///< Inizio degli slot, multiplo della pagina
+            std::uint64_t checksum; ///< Dei campi precedenti
+            state states[2];
+        };
+
+        char *_map; ///< Inizio della mappatura
+        size_type _length; ///< Lunghezza della mappatura
+        header *_header;
+        T *_slots; ///< _capacity + 1 slot
+        size_type _capacity;
+        state _current; ///< Copia della versione valida più recente
+        persistent_sync _sync;
+        size_type _interval; ///< n di sync_every_n
+        size_type _unsynced; ///< Inserimenti dall'ultimo msync
+
+        persistent_cbuffer(const persistent_cbuffer &other) = delete;
+        persistent_cbuffer &operator=(const persistent_cbuffer &other) = delete;
+
+        static void fail(const char *what){
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+        /// FNV-1a a 64 bit
+        static std::uint64_t hash(const void *data, std::size_t n){
+            const unsigned char *p = static_cast<const unsigned char *>(data);
+            std::uint64_t h = 0xcbf29ce484222325ULL;
+            for(std::size_t i = 0; i < n; ++i){
+                h ^= p[i];
+                h *= 0x100000001b3ULL;
+            }
+            return h;
+        }
+
+        static std::uint64_t header_checksum(const header &h){
+            return hash(&h, offsetof(header, checksum));
+        }
+
+        /// true se l'intestazione è tutta a zero o è quella di un file lasciato a metà da create
+        static bool blank(const header &h){
+            const unsigned char *p = reinterpret_cast<const unsigned char *>(&h);
+            std::size_t i = 0;
+            while(i < sizeof(h) && p[i] == 0)
+                ++i;
+            return i == sizeof(h) || (h.magic == 0 && h.version == version && h.checksum == header_checksum(h));
+        }
+
+        static std::uint64_t state_checksum(const state &s){
+            return hash(&s, offsetof(state, checksum));
+        }
+
+        bool valid(const state &s) const {
+            return s.checksum == state_checksum(s) && s.head <= s.tail && s.tail - s.head <= _capacity;
+        }
+
+        size_type slot(std::uint64_t seq) const {
+            return static_cast<size_type>(seq % (_capacity + 1));
+        }
+
+        /// msync delle pagine che contengono [p, p + n)
+        void sync_range(const void *p, size_type n){
+            std::uintptr_t page = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+            std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(p) & ~(page - 1);
+            std::uintptr_t end = reinterpret_cast<std::uintptr_t>(p) + n;
+            if(msync(reinterpret_cast<void *>(begin), end - begin, MS_SYNC) != 0)
+                fail("msync");
+        }
+
+        /**
+        @brief Rende persistenti testa e coda scrivendo la copia inattiva
+
+        @param written slot appena scritto da rendere durevole prima dell'intestazione, o 0
+        **/
+        void commit(std::uint64_t head, std::uint64_t tail, const T *written){
+            // l'elemento deve essere in memoria prima della nuova coda
+            std::atomic_signal_fence(std::memory_order_release);
+            if(_sync == sync_every_insert && written)
+                sync_range(written, sizeof(T));
+            state next;
+            std::memset(&next, 0, sizeof(next));
+            next.generation = _current.generation + 1;
+            next.head = head;
+            next.tail = tail;
+            next.checksum = state_checksum(next);
+            state &target = _header->states[next.generation & 1];
+            std::memcpy(&target, &next, sizeof(next));
+            std::atomic_signal_fence(std::memory_order_release);
+            _current = next;
+            if(_sync == sync_every_insert)
+                sync_range(&target, sizeof(target));
+            else if(_sync == sync_every_n && written && ++_unsynced >= _interval)
+                flush();
+        }
+
+        void create(int fd, size_type capacity, size_type page){
+            _capacity = capacity;
+            _length = page + (capacity + 1) * sizeof(T);
+            if(ftruncate(fd, _length) != 0)
+                fail("ftruncate");
+            map(fd);
+            header h;
+            std::memset(&h, 0, sizeof(h));
+            h.version = version;
+            h.element_size = sizeof(T);
+            h.capacity = capacity;
+            h.data_offset = page;
+            h.states[0].checksum = state_checksum(h.states[0]);
+            std::memcpy(_header, &h, sizeof(h));
+            _header->checksum = header_checksum(*_header);
+            std::atomic_signal_fence(std::memory_order_release);
+            // il magic per ultimo: un file creato a metà viene reinizializzato
+            _header->magic = magic;
+            _header->checksum = header_checksum(*_header);
+            if(_sync != sync_never)
+                sync_range(_header, sizeof(header));
+            _current = h.states[0];
+        }
+
+        void map(int fd){
+            void *area = mmap(0, _length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if(area == MAP_FAILED)
+                fail("mmap");
+            _map = static_cast<char *>(area);
+            _header = reinterpret_cast<header *>(_map);
+        }
+
+    public:
+        /**
+        @brief Apertura o creazione del buffer nel file path
+
+        Se il file non esiste, è vuoto, ha l'intestazione tutta a zero o non è stato inizializzato
+        completamente viene creato con la capacità indicata; altrimenti viene mappato così com'è
+        dopo averne controllato intestazione e checksum, senza leggere gli elementi.
+        Un file con contenuto diverso non viene mai modificato: il costruttore genera
+        std::runtime_error, così come quando il file va creato e capacity è 0 (in quel caso
+        il file non viene creato)
+        @param path File che contiene il buffer
+        @param capacity Capacità del buffer; 0 per accettare quella di un file esistente
+        @param sync Politica di msync
+        @param interval Numero di inserimenti tra due msync con sync_every_n
+        **/
+        persistent_cbuffer(const std::string &path, size_type capacity, persistent_sync sync = sync_never,
+                size_type interval = 1024):
+            _map(0), _length(0), _header(0), _slots(0), _capacity(0), _current(),
+            _sync(sync), _interval(interval > 0 ? interval : 1), _unsynced(0) {
+            bool created = false;
+            int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+            if(fd < 0 && errno == ENOENT){
+                if(capacity == 0)
+                    throw std::runtime_error("persistent_cbuffer needs a capacity to create a file");
+                fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+                created = fd >= 0;
+            }
+            if(fd < 0)
+                fail("open");
+            try{
+                size_type page = static_cast<size_type>(sysconf(_SC_PAGESIZE));
+                struct stat st;
+                if(fstat(fd, &st) != 0)
+                    fail("fstat");
+                header h;
+                std::memset(&h, 0, sizeof(h));
+                size_type prefix = std::min(static_cast<size_type>(st.st_size), sizeof(header));
+                if(pread(fd, &h, prefix, 0) != static_cast<ssize_t>(prefix))
+                    fail("pread");
+                if(h.magic != magic){
+                    if(!blank(h))
+                        throw std::runtime_error("persistent_cbuffer file has foreign content");
+                    if(capacity == 0)
+                        throw std::runtime_error("persistent_cbuffer needs a capacity to create a file");
+                    create(fd, capacity, page);
+                }else{
+                    if(h.checksum != header_checksum(h) || h.version != version)
+                        throw std::runtime_error("persistent_cbuffer header corrupted");
+                    if(h.element_size != sizeof(T))
+                        throw std::runtime_error("persistent_cbuffer element size mismatch");
+                    if(capacity != 0 && h.capacity != capacity)
+                        throw std::runtime_error("persistent_cbuffer capacity mismatch");
+                    _capacity = static_cast<size_type>(h.capacity);
+                    _length = static_cast<size_type>(h.data_offset) + (_capacity + 1) * sizeof(T);
+                    if(static_cast<size_type>(st.st_size) < _length)
+                        throw std::runtime_error("persistent_cbuffer file truncated");
+                    bool v0 = valid(h.states[0]), v1 = valid(h.states[1]);
+                    if(!v0 && !v1)
+                        throw std::runtime_error("persistent_cbuffer state corrupted");
+                    _current = !v1 || (v0 && h.states[0].generation > h.states[1].generation) ? h.states[0] : h.states[1];
+                    map(fd);
+                }
+                _slots = reinterpret_cast<T *>(_map + _header->data_offset);
+            }catch(...){
+                if(_map)
+                    munmap(_map, _length);
+                close(fd);
+                if(created)
+                    unlink(path.c_str());
+                throw;
+            }
+            close(fd);
+        }
+
+        /**
+        @brief Distruttore
+
+        Con una politica diversa da sync_never esegue un ultimo msync
+        **/
+        ~persistent_cbuffer(){
+            if(_sync != sync_never)
+                msync(_map, _length, MS_SYNC);
+            munmap(_map, _length);
+        }
+
+        /**
+        @brief Inserimento di un elemento in coda
+
+        Se il buffer è pieno sovrascrive il più vecchio
+        @return insert_added o insert_overwritten
+        **/
+        insert_result insert(const T &value){
+            T *target = _slots + slot(_current.tail);
+            std::memcpy(static_cast<void *>(target), &value, sizeof(T));
+            bool overwrite = full();
+            commit(_current.head + overwrite, _current.tail + 1, target);
+            return overwrite ? insert_overwritten : insert_added;
+        }
+
+        /**
+        @brief Rimozione dell'elemento più vecchio
+
+        @return true se un elemento è stato rimosso, false se il buffer era vuoto
+        **/
+        bool remove(){
+            if(empty())
+                return false;
+            commit(_current.head + 1, _current.tail, 0);
+            return true;
+        }
+
+        /**
+        @brief Estrazione dell'elemento più vecchio
+
+        Se il buffer è vuoto genera un eccezione out_of_range
+        **/
+        T pop(){
+            if(empty())
+                throw std::out_of_range("Pop from empty cbuffer");
+            T value = (*this)[0];
+            remove();
+            return value;
+        }
+
+        /**
+        @brief Svuotamento del buffer
+        **/
+        void clear(){
+            commit(_current.tail, _current.tail, 0);
+        }
+
+        /**
+        @brief Accesso in lettura all'elemento in posizione logica index
+
+        Se index non è valido genera un eccezione out_of_range
+        **/
+        const T &operator[](size_type index) const {
+            if(index >= count())
+                throw std::out_of_range("Index out of range");
+            return _slots[slot(_current.head + index)];
+        }
+
+        /**
+        @brief msync dell'intero file
+        **/
+        void flush(){
+            if(msync(_map, _length, MS_SYNC) != 0)
+                fail("msync");
+            _unsynced = 0;
+        }
+
+        /**
+        @brief Numero di elementi presenti
+        **/
+        size_type count() const {
+            return static_cast<size_type>(_current.tail - _current.head);
+        }
+
+        /**
+        @brief Capacità del buffer
+        **/
+        size_type size() const {
+            return _capacity;
+        }
+
+        bool empty() const {
+            return _current.tail == _current.head;
+        }
+
+        bool full() const {
+            return count() == _capacity;
+        }
+
+        /**
+        @brief Numero totale di inserimenti dalla creazione del file
+        **/
+        std::uint64_t inserted() const {
+            return _current.tail;
+        }
+};
+
+/**
+@brief Operatore di stream
+
+Stesso formato di cbuffer
+**/
+template <typename T>
+std::ostream &operator<<(std::ostream &os, const persistent_cbuffer<T> &cb){
+    if(cb.empty())
+        return os << "Empty cbuffer";
+    for(typename persistent_cbuffer<T>::size_type i = 0; i < cb.count(); ++i)
+        os << "[" << cb[i] << "]";
+    return os;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,509 @@
+#ifndef SOA_CBUFFER_H
+#define SOA_CBUFFER_H
+
+#include "cbuffer.hpp"
+#include "voce.h"
+#include <tuple>
+#include <vector>
+#include <span>
+#include <utility>
+#include <type_traits>
+
+/**
+@file soa_cbuffer.hpp
+@brief Dichiarazione della classe soa_cbuffer, buffer circolare a colonne
+**/
+
+/**
+@brief Descrizione dei campi di un record per soa_cbuffer
+
+Una specializzazione espone fields, una tupla di puntatori ai membri nell'ordine delle
+colonne; il record deve essere costruibile passando i valori dei campi in quell'ordine.
+Per std::tuple le colonne sono gli elementi della tupla (vedi la specializzazione)
+**/
+template <typename Record>
+struct soa_traits;
+
+/**
+@brief Colonne di voce: cognome, nome e ntel
+**/
+template <>
+struct soa_traits<voce> {
+    static constexpr auto fields = std::make_tuple(&voce::cognome, &voce::nome, &voce::ntel);
+};
+
+/**
+@brief Indici delle colonne di soa_cbuffer<voce>
+**/
+enum voce_column {
+    voce_cognome,
+    voce_nome,
+    voce_ntel
+};
+
+namespace soa_detail {
+
+/// Numero e tipi delle colonne di Record, campo I-esimo di un record
+template <typename Record>
+struct columns {
+    typedef std::remove_const_t<decltype(soa_traits<Record>::fields)> fields_type;
+    static constexpr std::size_t count = std::tuple_size<fields_type>::value;
+
+    template <std::size_t I>
+    struct member;
+
+    template <std::size_t I>
+    using type = typename member<I>::type;
+
+    template <std::size_t I>
+    static auto &get(Record &r) { return r.*std::get<I>(soa_traits<Record>::fields); }
+
+    template <std::size_t I>
+    static const auto &get(const Record &r) { return r.*std::get<I>(soa_traits<Record>::fields); }
+};
+
+template <typename Record>
+template <std::size_t I>
+struct columns<Record>::member {
+    template <typename C, typename M>
+    static M field_of(M C::*);
+    typedef decltype(field_of(std::get<I>(soa_traits<Record>::fields))) type;
+};
+
+template <typename... Ts>
+struct columns<std::tuple<Ts...> > {
+    static constexpr std::size_t count = sizeof...(Ts);
+
+    template <std::size_t I>
+    using type = std::tuple_element_t<I, std::tuple<Ts...> >;
+
+    template <std::size_t I>
+    static auto &get(std::tuple<Ts...> &r) { return std::get<I>(r); }
+
+    template <std::size_t I>
+    static const auto &get(const std::tuple<Ts...> &r) { return std::get<I>(r); }
+};
+
+/// Tupla di std::vector, uno per colonna
+template <typename Record, typename Seq = std::make_index_sequence<columns<Record>::count> >
+struct storage;
+
+template <typename Record, std::size_t... I>
+struct storage<Record, std::index_sequence<I...> > {
+    typedef std::tuple<std::vector<typename columns<Record>::template type<I> >...> type;
+};
+
+} // namespace soa_detail
+
+/**
+@brief Buffer circolare a colonne (structure of arrays)
+
+Ogni campo di Record, descritto da soa_traits<Record> o dagli elementi di una std::tuple,
+è memorizzato in un proprio array circolare; tutte le colonne condividono testa e numero
+di elementi. Una scansione che legge un solo campo (ad esempio i prefissi di voce::ntel)
+attraversa solo la memoria di quella colonna: array_one<I>() e array_two<I>() ne danno i
+due tratti contigui come per cbuffer. operator[] e gli iteratori restituiscono un riferimento
+proxy da cui leggere i singoli campi con get<I>() o l'intero record per conversione.
+Come per cbuffer, quando il buffer è pieno l'inserimento sovrascrive l'elemento più vecchio.
+I campi devono essere costruibili di default: gli slot liberi contengono un valore
+che viene riassegnato all'inserimento, riusando ad esempio la memoria delle stringhe
+**/
+template <typename Record>
+class soa_cbuffer {
+        typedef soa_detail::columns<Record> columns;
+        static constexpr std::size_t _columns = columns::count;
+    public:
+        typedef Record value_type; ///< Definzione del tipo corrispondente al record
+        typedef int size_type; ///< Definzione del tipo corrispondente a size, dimensione del buffer
+
+        template <std::size_t I>
+        using column_type = typename columns::template type<I>; ///< Tipo della colonna I
+    private:
+        typename soa_detail::storage<Record>::type _data; ///< Array delle colonne, _size elementi ciascuno
+        size_type _size; ///< Capacità
+        size_type _start; ///< Indice fisico dell'elemento più vecchio
+        size_type _end; ///< Numero di elementi inseriti
+
+        size_type physical(size_type index) const {
+            size_type pos = _start + index;
+            return pos < _size ? pos : pos - _size;
+        }
+
+        template <std::size_t I>
+        column_type<I> *column_data() { return std::get<I>(_data).data(); }
+
+        template <std::size_t I>
+        const column_type<I> *column_data() const { return std::get<I>(_data).data(); }
+
+        /// Scrive i campi di r nello slot pos
+        template <typename R, std::size_t... I>
+        void store(size_type pos, R &&r, std::index_sequence<I...>) {
+            if constexpr(std::is_rvalue_reference<R &&>::value)
+                ((std::get<I>(_data)[pos] = std::move(columns::template get<I>(r))), ...);
+            else
+                ((std::get<I>(_data)[pos] = columns::template get<I>(r)), ...);
+        }
+
+        template <typename... Args, std::size_t... I>
+        void store_fields(size_type pos, std::index_sequence<I...>, Args&&... args) {
+            ((std::get<I>(_data)[pos] = std::forward<Args>(args)), ...);
+        }
+
+        /// Slot di coda per un nuovo elemento, avanza la testa se il buffer è pieno
+        size_type push_slot(insert_result &r) {
+            if(!full()){
+                r = insert_added;
+                return physical(_end++);
+            }
+            size_type pos = _start;
+            _start = physical(1);
+            r = insert_overwritten;
+            return pos;
+        }
+
+        template <std::size_t... I>
+        Record make(size_type pos, std::index_sequence<I...>) const {
+            return Record(std::get<I>(_data)[pos]...);
+        }
+
+        template <std::size_t... I>
+        Record take(size_type pos, std::index_sequence<I...>) {
+            return Record(std::move(std::get<I>(_data)[pos])...);
+        }
+
+        template <bool Const>
+        class basic_reference;
+
+        template <bool Const>
+        class basic_iterator;
+
+    public:
+        typedef basic_reference<false> reference; ///< Riferimento proxy a un record
+        typedef basic_reference<true> const_reference; ///< Riferimento proxy costante a un record
+        typedef basic_iterator<false> iterator; ///< Iteratore in ordine logico
+        typedef basic_iterator<true> const_iterator; ///< Iteratore costante in ordine logico
+
+        /**
+        @brief Costruttore di default
+
+        Crea un buffer vuoto con capacità 0
+        **/
+        soa_cbuffer(): _data(), _size(0), _start(0), _end(0) {}
+
+        /**
+        @brief Costruttore con capacità
+
+        Alloca un array di size elementi per ogni colonna
+        @param size Capacità del buffer
+        **/
+        explicit soa_cbuffer(size_type size): _data(), _size(size > 0 ? size : 0), _start(0), _end(0) {
+            std::apply([this](auto &...col){ (col.resize(_size), ...); }, _data);
+        }
+
+        soa_cbuffer(const soa_cbuffer &other) = default;
+
+        soa_cbuffer &operator=(const soa_cbuffer &other) = default;
+
+        /**
+        @brief Costruttore di spostamento
+
+        other resta vuoto con capacità 0
+        **/
+        soa_cbuffer(soa_cbuffer &&other) noexcept: soa_cbuffer() {
+            swap(other);
+        }
+
+        soa_cbuffer &operator=(soa_cbuffer &&other) noexcept {
+            soa_cbuffer tmp(std::move(other));
+            swap(tmp);
+            return *this;
+        }
+
+        void swap(soa_cbuffer &other) noexcept {
+            std::swap(_data, other._data);
+            std::swap(_size, other._size);
+            std::swap(_start, other._start);
+            std::swap(_end, other._end);
+        }
+
+        bool empty() const {
+            return _end == 0;
+        }
+
+        /**
+        @brief Controllo se il buffer è pieno
+
+        Come per cbuffer, un buffer di capacità 0 non è mai pieno
+        **/
+        bool full() const {
+            return _end == _size && _size > 0;
+        }
+
+        /**
+        @brief Capacità del buffer
+        **/
+        size_type size() const {
+            return _size;
+        }
+
+        /**
+        @brief Numero di elementi presenti
+        **/
+        size_type count() const {
+            return _end;
+        }
+
+        /**
+        @brief Inserimento di un record in coda
+
+        Copia ogni campo nella propria colonna, se il buffer è pieno sovrascrive il più vecchio
+        @param value Record da inserire
+        @return insert_added, insert_overwritten o insert_rejected se la capacità è 0
+        **/
+        insert_result insert(const Record &value) {
+            if(_size == 0)
+                return insert_rejected;
+            insert_result r;
+            size_type pos = push_slot(r);
+            store(pos, value, std::make_index_sequence<_columns>());
+            return r;
+        }
+
+        /**
+        @brief Inserimento per spostamento di un record in coda
+        **/
+        insert_result insert(Record &&value) {
+            if(_size == 0)
+                return insert_rejected;
+            insert_result r;
+            size_type pos = push_slot(r);
+            store(pos, std::move(value), std::make_index_sequence<_columns>());
+            return r;
+        }
+
+        /**
+        @brief Inserimento dei campi di un record senza costruirlo
+
+        @param args Un valore per ogni colonna, nell'ordine delle colonne
+        **/
+        template <typename... Args>
+            requires (sizeof...(Args) == columns::count)
+        insert_result emplace(Args&&... args) {
+            if(_size == 0)
+                return insert_rejected;
+            insert_result r;
+            size_type pos = push_slot(r);
+            store_fields(pos, std::make_index_sequence<_columns>(), std::forward<Args>(args)...);
+            return r;
+        }
+
+        /**
+        @brief Rimozione del record più vecchio
+
+        I campi restano nelle colonne fino alla successiva sovrascrittura
+        @return true se un record è stato rimosso, false se il buffer era vuoto
+        **/
+        bool remove() {
+            if(empty())
+                return false;
+            _start = physical(1);
+            --_end;
+            return true;
+        }
+
+        /**
+        @brief Estrazione del record più vecchio
+
+        Se il buffer è vuoto genera un eccezione out_of_range
+        @return il record, costruito spostando i campi fuori dalle colonne
+        **/
+        Record pop() {
+            if(empty())
+                throw std::out_of_range("Pop from empty soa_cbuffer");
+            Record value(take(_start, std::make_index_sequence<_columns>()));
+            remove();
+            return value;
+        }
+
+        /**
+        @brief Accesso a un record
+
+        Genera un eccezione out_of_range se index non è minore del numero di elementi
+        @param index Indice logico, 0 è il più vecchio
+        @return riferimento proxy al record
+        **/
+        reference operator[](size_type index) {
+            if(index < 0 || index >= _end)
+                throw std::out_of_range("Index out of range");
+            return reference(this, physical(index));
+        }
+
+        const_reference operator[](size_type index) const {
+            if(index < 0 || index >= _end)
+                throw std::out_of_range("Index out of range");
+            return const_reference(this, physical(index));
+        }
+
+        /**
+        @brief Primo tratto contiguo della colonna I
+
+        Dall'elemento più vecchio fino alla fine dell'array o all'ultimo elemento
+        **/
+        template <std::size_t I>
+        std::span<const column_type<I> > array_one() const {
+            return std::span<const column_type<I> >(column_data<I>() + _start, std::min(_end, _size - _start));
+        }
+
+        /**
+        @brief Secondo tratto contiguo della colonna I, vuoto se gli elementi non attraversano il wrap
+        **/
+        template <std::size_t I>
+        std::span<const column_type<I> > array_two() const {
+            return std::span<const column_type<I> >(column_data<I>(), _end - std::min(_end, _size - _start));
+        }
+
+        template <std::size_t I>
+        std::span<column_type<I> > array_one() {
+            return std::span<column_type<I> >(column_data<I>() + _start, std::min(_end, _size - _start));
+        }
+
+        template <std::size_t I>
+        std::span<column_type<I> > array_two() {
+            return std::span<column_type<I> >(column_data<I>(), _end - std::min(_end, _size - _start));
+        }
+
+        iterator begin() { return iterator(this, 0); }
+        iterator end() { return iterator(this, _end); }
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, _end); }
+};
+
+/**
+@brief Riferimento proxy a un record di soa_cbuffer
+
+Contiene il buffer e la posizione fisica: get<I>() restituisce il campo I nella sua colonna,
+la conversione a Record ricompone una copia del record e, per i riferimenti non costanti,
+l'assegnamento da Record o da un altro riferimento scrive tutti i campi
+**/
+template <typename Record>
+template <bool Const>
+class soa_cbuffer<Record>::basic_reference {
+        typedef typename std::conditional<Const, const soa_cbuffer, soa_cbuffer>::type owner_type;
+
+        owner_type *_cb;
+        size_type _pos;
+
+        friend class soa_cbuffer;
+        friend class basic_iterator<Const>;
+
+        basic_reference(owner_type *cb, size_type pos): _cb(cb), _pos(pos) {}
+
+    public:
+        /// Conversione reference -> const_reference
+        template <bool C = Const, typename = typename std::enable_if<C>::type>
+        basic_reference(const basic_reference<false> &other): _cb(other._cb), _pos(other._pos) {}
+
+        template <std::size_t I>
+        auto &get() const {
+            return std::get<I>(_cb->_data)[_pos];
+        }
+
+        operator Record() const {
+            return _cb->make(_pos, std::make_index_sequence<_columns>());
+        }
+
+        basic_reference(const basic_reference &other) = default;
+
+        template <bool C = Const, typename = typename std::enable_if<!C>::type>
+        const basic_reference &operator=(const Record &value) const {
+            _cb->store(_pos, value, std::make_index_sequence<_columns>());
+            return *this;
+        }
+
+        /// Assegnamento tra righe: copia il record riferito da other, non il proxy
+        const basic_reference &operator=(const basic_reference &other) const requires (!Const) {
+            _cb->store(_pos, Record(other), std::make_index_sequence<_columns>());
+            return *this;
+        }
+
+        /// Assegnamento da una riga in sola lettura, anche di un altro soa_cbuffer
+        template <bool C>
+            requires (!Const && C)
+        const basic_reference &operator=(const basic_reference<C> &other) const {
+            _cb->store(_pos, Record(other), std::make_index_sequence<_columns>());
+            return *this;
+        }
+};
+
+/**
+@brief Iteratore in ordine logico su soa_cbuffer
+
+operator* restituisce un riferimento proxy, per questo la categoria dichiarata è input
+**/
+template <typename Record>
+template <bool Const>
+class soa_cbuffer<Record>::basic_iterator {
+        typedef typename std::conditional<Const, const soa_cbuffer, soa_cbuffer>::type owner_type;
+
+        owner_type *_cb;
+        size_type _index;
+
+        friend class soa_cbuffer;
+        friend class basic_iterator<!Const>;
+
+        basic_iterator(owner_type *cb, size_type index): _cb(cb), _index(index) {}
+
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef Record value_type;
+        typedef ptrdiff_t difference_type;
+        typedef void pointer;
+        typedef basic_reference<Const> reference;
+
+        basic_iterator(): _cb(0), _index(0) {}
+
+        /// Conversione iterator -> const_iterator
+        template <bool C = Const, typename = typename std::enable_if<C>::type>
+        basic_iterator(const basic_iterator<false> &other): _cb(other._cb), _index(other._index) {}
+
+        reference operator*() const { return reference(_cb, _cb->physical(_index)); }
+        reference operator[](difference_type n) const { return reference(_cb, _cb->physical(_index + n)); }
+
+        basic_iterator &operator++() { ++_index; return *this; }
+        basic_iterator operator++(int) { basic_iterator tmp(*this); ++_index; return tmp; }
+        basic_iterator &operator--() { --_index; return *this; }
+        basic_iterator operator--(int) { basic_iterator tmp(*this); --_index; return tmp; }
+        basic_iterator &operator+=(difference_type n) { _index += n; return *this; }
+        basic_iterator &operator-=(difference_type n) { _index -= n; return *this; }
+        basic_iterator operator+(difference_type n) const { return basic_iterator(_cb, _index + n); }
+        basic_iterator operator-(difference_type n) const { return basic_iterator(_cb, _index - n); }
+        difference_type operator-(const basic_iterator &other) const { return _index - other._index; }
+
+        bool operator==(const basic_iterator &other) const { return _index == other._index; }
+        bool operator!=(const basic_iterator &other) const { return _index != other._index; }
+        bool operator<(const basic_iterator &other) const { return _index < other._index; }
+};
+
+/**
+@brief Swap tra due soa_cbuffer
+**/
+template <typename Record>
+void swap(soa_cbuffer<Record> &a, soa_cbuffer<Record> &b) noexcept {
+    a.swap(b);
+}
+
+/**
+@brief Operatore di stream
+
+Stesso formato di cbuffer, richiede operator<< su Record
+**/
+template <typename Record>
+std::ostream &operator<<(std::ostream &os, const soa_cbuffer<Record> &cb){
+    if(cb.empty())
+        return os << "Empty cbuffer";
+    for(typename soa_cbuffer<Record>::const_iterator it = cb.begin(); it != cb.end(); ++it)
+        os << "[" << static_cast<Record>(*it) << "]";
+    return os;
+}
+
+#endif
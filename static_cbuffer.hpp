@@ -0,0 +1,312 @@
+#ifndef STATIC_CBUFFER_H
+#define STATIC_CBUFFER_H
+
+#include "cbuffer.hpp"
+#include <compare>
+#include <type_traits>
+
+/**
+@file static_cbuffer.hpp
+@brief Dichiarazione della classe static_cbuffer
+**/
+
+/**
+@brief Buffer circolare a capacità fissata in compilazione
+
+Stessa interfaccia di cbuffer, ma la capacità N è un parametro template e gli elementi
+sono memorizzati in un array interno all'oggetto: nessuna allocazione dinamica, può
+stare sullo stack o dentro altre strutture. Se N è una potenza di due la posizione
+nell'array si ottiene con una maschera. Tutte le operazioni sono constexpr, quindi
+il buffer è usabile anche in espressioni costanti quando T è un tipo letterale.
+T deve essere costruibile di default: gli slot liberi contengono un valore di T
+che viene riassegnato all'inserimento
+**/
+template <typename T, int N>
+class static_cbuffer{
+        static_assert(N >= 0, "static_cbuffer capacity must be non-negative");
+    public:
+        typedef T value_type; ///< Definzione del tipo corrispondente al valore contenuto del buffer
+        typedef int size_type; ///< Definzione del tipo corrispondente a size, dimensione del buffer
+    private:
+        static constexpr bool _pow2 = N > 0 && (N & (N - 1)) == 0; ///< true se N è una potenza di due
+
+        T _buffer[N > 0 ? N : 1]; ///< Array degli elementi
+        size_type _end; ///< Numero di elementi inseriti
+        size_type _start; ///< Indice fisico dell'elemento più vecchio
+
+        /**
+        @brief Indice fisico dell'elemento logico index
+        **/
+        static constexpr size_type wrap(size_type pos){
+            if constexpr(_pow2)
+                return pos & (N - 1);
+            else
+                return pos < N ? pos : pos - N;
+        }
+
+        constexpr size_type physical(size_type index) const {
+            return wrap(_start + index);
+        }
+
+        /**
+        @brief Iteratore ad accesso casuale in ordine logico
+
+        Const è true per const_iterator; la posizione è _start + indice logico
+        e viene riportata nell'array solo al dereferenziamento
+        **/
+        template <bool Const>
+        class basic_iterator {
+            typedef typename std::conditional<Const, const static_cbuffer, static_cbuffer>::type owner_type;
+
+            owner_type *_cb;
+            size_type _pos;
+
+            friend class static_cbuffer;
+            friend class basic_iterator<!Const>;
+
+            constexpr basic_iterator(owner_type *cb, size_type pos): _cb(cb), _pos(pos) {}
+
+        public:
+            typedef std::random_access_iterator_tag iterator_concept;
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef T value_type;
+            typedef ptrdiff_t difference_type;
+            typedef typename std::conditional<Const, const T *, T *>::type pointer;
+            typedef typename std::conditional<Const, const T &, T &>::type reference;
+
+            constexpr basic_iterator(): _cb(0), _pos(0) {}
+
+            // Conversione iterator -> const_iterator
+            template <bool C = Const, typename = typename std::enable_if<C>::type>
+            constexpr basic_iterator(const basic_iterator<false> &other): _cb(other._cb), _pos(other._pos) {}
+
+            constexpr reference operator*() const { return _cb->_buffer[wrap(_pos)]; }
+            constexpr pointer operator->() const { return &_cb->_buffer[wrap(_pos)]; }
+            constexpr reference operator[](difference_type n) const { return _cb->_buffer[wrap(_pos + n)]; }
+
+            constexpr basic_iterator &operator++() { ++_pos; return *this; }
+            constexpr basic_iterator operator++(int) { basic_iterator tmp(*this); ++_pos; return tmp; }
+            constexpr basic_iterator &operator--() { --_pos; return *this; }
+            constexpr basic_iterator operator--(int) { basic_iterator tmp(*this); --_pos; return tmp; }
+            constexpr basic_iterator &operator+=(difference_type n) { _pos += n; return *this; }
+            constexpr basic_iterator &operator-=(difference_type n) { _pos -= n; return *this; }
+            constexpr basic_iterator operator+(difference_type n) const { return basic_iterator(_cb, _pos + n); }
+            constexpr basic_iterator operator-(difference_type n) const { return basic_iterator(_cb, _pos - n); }
+            friend constexpr basic_iterator operator+(difference_type n, const basic_iterator &it) { return it + n; }
+
+            template <bool C>
+            constexpr difference_type operator-(const basic_iterator<C> &other) const { return _pos - other._pos; }
+
+            template <bool C>
+            constexpr bool operator==(const basic_iterator<C> &other) const { return _pos == other._pos; }
+
+            template <bool C>
+            constexpr std::strong_ordering operator<=>(const basic_iterator<C> &other) const { return _pos <=> other._pos; }
+        };
+
+    public:
+        typedef basic_iterator<false> iterator; ///< Iteratore in ordine logico
+        typedef basic_iterator<true> const_iterator; ///< Iteratore costante in ordine logico
+
+        /**
+        @brief Costruttore di default
+
+        Crea un buffer vuoto di capacità N
+        **/
+        constexpr static_cbuffer(): _buffer(), _end(0), _start(0) {}
+
+        /**
+        @brief Costruttore con default value
+
+        Crea un buffer pieno con tutti gli N elementi uguali a value
+        @param value Valore usato per instanziare gli elementi
+        **/
+        constexpr explicit static_cbuffer(const T &value): _buffer(), _end(N), _start(0) {
+            for(size_type i = 0; i < N; ++i)
+                _buffer[i] = value;
+        }
+
+        /**
+        @brief Costruttore con due iteratori
+
+        Inserisce in ordine la sequenza [begin, finish), se è più lunga di N
+        restano solo gli ultimi N elementi
+        @param begin Iteratore che punta al primo elemento della sequenza
+        @param finish Iteratore che punta alla fine della sequenza
+        **/
+        template <typename iteratorQ>
+        constexpr static_cbuffer(iteratorQ begin, iteratorQ finish): _buffer(), _end(0), _start(0) {
+            for(; begin != finish; ++begin)
+                insert(*begin);
+        }
+
+        /**
+        @brief Swap tra due static_cbuffer
+
+        Scambia elemento per elemento, costo O(N)
+        @param other Buffer con cui verrano scambiati i dati
+        **/
+        constexpr void swap(static_cbuffer &other) {
+            for(size_type i = 0; i < N; ++i){
+                T tmp(std::move(_buffer[i]));
+                _buffer[i] = std::move(other._buffer[i]);
+                other._buffer[i] = std::move(tmp);
+            }
+            size_type e = _end; _end = other._end; other._end = e;
+            size_type s = _start; _start = other._start; other._start = s;
+        }
+
+        /**
+        @brief Controllo se il buffer è vuoto
+        **/
+        constexpr bool empty() const {
+            return _end == 0;
+        }
+
+        /**
+        @brief Controllo se il buffer è pieno
+
+        Come per cbuffer, un buffer di capacità 0 non è mai pieno
+        **/
+        constexpr bool full() const {
+            return _end >= N && N > 0;
+        }
+
+        /**
+        @brief Capacità del buffer
+
+        @return N
+        **/
+        constexpr size_type size() const {
+            return N;
+        }
+
+        /**
+        @brief Inserimento di un elemento in coda al buffer
+
+        Se il buffer è pieno il valore sovrascrive quello più vecchio
+        @param value Valore da inserire
+        @return insert_added, insert_overwritten o insert_rejected se N è 0
+        **/
+        constexpr insert_result insert(const T &value) {
+            return emplace(value);
+        }
+
+        /**
+        @brief Inserimento per spostamento di un elemento in coda al buffer
+        **/
+        constexpr insert_result insert(T &&value) {
+            return emplace(std::move(value));
+        }
+
+        /**
+        @brief Costruzione di un elemento in coda al buffer
+
+        Costruisce un T da args e lo assegna allo slot di coda
+        @param args Argomenti del costruttore di T
+        @return insert_added, insert_overwritten o insert_rejected se N è 0
+        **/
+        template <typename... Args>
+        constexpr insert_result emplace(Args&&... args) {
+            if(N == 0)
+                return insert_rejected;
+            if(!full()){
+                _buffer[physical(_end)] = T(std::forward<Args>(args)...);
+                ++_end;
+                return insert_added;
+            }
+            _buffer[_start] = T(std::forward<Args>(args)...);
+            _start = wrap(_start + 1);
+            return insert_overwritten;
+        }
+
+        /**
+        @brief Rimozione dell'elemento più vecchio
+
+        @return true se un elemento è stato rimosso, false se il buffer era vuoto
+        **/
+        constexpr bool remove() {
+            if(empty())
+                return false;
+            _start = wrap(_start + 1);
+            --_end;
+            return true;
+        }
+
+        /**
+        @brief Estrazione dell'elemento più vecchio
+
+        Se il buffer è vuoto genera un eccezione out_of_range
+        @return l'elemento più vecchio
+        **/
+        constexpr T pop() {
+            if(empty())
+                throw std::out_of_range("Pop from empty static_cbuffer");
+            T value(std::move(_buffer[_start]));
+            remove();
+            return value;
+        }
+
+        /**
+        @brief Accesso ai dati
+
+        Genera un eccezione out_of_range se index non è minore del numero di elementi
+        @param index Indice logico, 0 è l'elemento più vecchio
+        @return Elemento in posizione index-esima
+        **/
+        constexpr T &operator[](size_type index) {
+            if(index < 0 || index >= _end)
+                throw std::out_of_range("Index out of range");
+            return _buffer[physical(index)];
+        }
+
+        /**
+        @brief Accesso ai dati in lettura
+        **/
+        constexpr const T &operator[](size_type index) const {
+            if(index < 0 || index >= _end)
+                throw std::out_of_range("Index out of range");
+            return _buffer[physical(index)];
+        }
+
+        constexpr iterator begin() { return iterator(this, _start); }
+        constexpr iterator end() { return iterator(this, _start + _end); }
+        constexpr const_iterator begin() const { return const_iterator(this, _start); }
+        constexpr const_iterator end() const { return const_iterator(this, _start + _end); }
+};
+
+/**
+@brief Swap tra due static_cbuffer
+**/
+template <typename T, int N>
+constexpr void swap(static_cbuffer<T, N> &a, static_cbuffer<T, N> &b) {
+    a.swap(b);
+}
+
+/**
+@brief Funzione su predicato unario
+
+Come evaluate_if per cbuffer: stampa per ogni elemento il risultato del predicato
+**/
+template <typename P, typename T, int N>
+void evaluate_if(const static_cbuffer<T, N> &cb, P pred){
+    int i = 0;
+    for(typename static_cbuffer<T, N>::const_iterator it = cb.begin(); it != cb.end(); ++it)
+        std::cout << "[" << i++ << "]: " << pred(*it) << std::endl;
+}
+
+/**
+@brief Operatore di stream
+
+Manda sullo stream di output il contenuto del buffer nello stesso formato di cbuffer
+**/
+template <typename T, int N>
+std::ostream &operator<<(std::ostream &os, const static_cbuffer<T, N> &cb){
+    if(cb.empty())
+        return os << "Empty cbuffer";
+    for(typename static_cbuffer<T, N>::const_iterator it = cb.begin(); it != cb.end(); ++it)
+        os << "[" << *it << "]";
+    return os;
+}
+
+#endif
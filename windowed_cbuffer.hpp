@@ -0,0 +1,418 @@
+#ifndef WINDOWED_CBUFFER_H
+#define WINDOWED_CBUFFER_H
+
+#include "cbuffer.hpp"
+#include <tuple>
+#include <vector>
+#include <type_traits>
+
+/**
+@file windowed_cbuffer.hpp
+@brief Dichiarazione della classe windowed_cbuffer e degli aggregatori incrementali
+
+Un aggregatore per elementi di tipo T espone:
+- void reset(int capacity): chiamato alla costruzione e quando la finestra viene svuotata
+- void push(const T &value): value è entrato nella finestra
+- void pop(const T &value): value, il più vecchio, sta per uscire dalla finestra
+**/
+
+/**
+@brief Numero di elementi nella finestra
+**/
+struct window_count {
+    int value; ///< Elementi presenti
+
+    window_count(): value(0) {}
+
+    void reset(int) { value = 0; }
+
+    template <typename T>
+    void push(const T &) { ++value; }
+
+    template <typename T>
+    void pop(const T &) { --value; }
+
+    int count() const { return value; }
+};
+
+/**
+@brief Somma degli elementi della finestra
+
+I tipi in virgola mobile sono accumulati in double con la compensazione di Neumaier,
+così l'errore non cresce con il numero di elementi entrati e usciti;
+gli interi in long long o unsigned long long
+**/
+template <typename T>
+class window_sum {
+    public:
+        typedef typename std::conditional<std::is_floating_point<T>::value, double,
+            typename std::conditional<std::is_signed<T>::value, long long, unsigned long long>::type>::type acc_type;
+    private:
+        acc_type _sum; ///< Somma corrente
+        acc_type _comp; ///< Errore di arrotondamento accumulato, sempre 0 per gli interi
+
+        void add(acc_type x){
+            if constexpr(std::is_floating_point<acc_type>::value){
+                acc_type t = _sum + x;
+                if((_sum < 0 ? -_sum : _sum) >= (x < 0 ? -x : x))
+                    _comp += (_sum - t) + x;
+                else
+                    _comp += (x - t) + _sum;
+                _sum = t;
+            }else
+                _sum += x;
+        }
+
+    public:
+        window_sum(): _sum(0), _comp(0) {}
+
+        void reset(int) { _sum = 0; _comp = 0; }
+
+        void push(const T &value) { add(static_cast<acc_type>(value)); }
+
+        void pop(const T &value) {
+            if constexpr(std::is_floating_point<acc_type>::value)
+                add(-static_cast<acc_type>(value));
+            else
+                _sum -= static_cast<acc_type>(value);
+        }
+
+        /**
+        @brief Somma degli elementi, 0 se la finestra è vuota
+        **/
+        acc_type sum() const { return _sum + _comp; }
+};
+
+/**
+@brief Media degli elementi della finestra
+
+Mantiene somma e numero di elementi, media() genera out_of_range se la finestra è vuota
+**/
+template <typename T>
+class window_mean {
+        window_sum<T> _sum; ///< Somma degli elementi
+        int _count; ///< Elementi presenti
+    public:
+        window_mean(): _sum(), _count(0) {}
+
+        void reset(int capacity) { _sum.reset(capacity); _count = 0; }
+
+        void push(const T &value) { _sum.push(value); ++_count; }
+
+        void pop(const T &value) { _sum.pop(value); --_count; }
+
+        double mean() const {
+            if(_count == 0)
+                throw std::out_of_range("Empty window");
+            return static_cast<double>(_sum.sum()) / _count;
+        }
+};
+
+/**
+@brief Varianza (di popolazione) della finestra con il metodo di Welford
+
+Media e somma dei quadrati degli scarti sono aggiornate in O(1) sia all'ingresso
+sia all'uscita di un elemento
+**/
+template <typename T>
+class window_variance {
+        int _count; ///< Elementi presenti
+        double _mean; ///< Media corrente
+        double _m2; ///< Somma dei quadrati degli scarti dalla media
+    public:
+        window_variance(): _count(0), _mean(0), _m2(0) {}
+
+        void reset(int) { _count = 0; _mean = 0; _m2 = 0; }
+
+        void push(const T &value) {
+            double x = static_cast<double>(value);
+            ++_count;
+            double d = x - _mean;
+            _mean += d / _count;
+            _m2 += d * (x - _mean);
+        }
+
+        void pop(const T &value) {
+            if(_count <= 1){
+                reset(0);
+                return;
+            }
+            double x = static_cast<double>(value);
+            double d = x - _mean;
+            _mean -= d / (_count - 1);
+            _m2 -= d * (x - _mean);
+            if(_m2 < 0)
+                _m2 = 0;
+            --_count;
+        }
+
+        /**
+        @brief Varianza, genera out_of_range se la finestra è vuota
+        **/
+        double variance() const {
+            if(_count == 0)
+                throw std::out_of_range("Empty window");
+            return _m2 / _count;
+        }
+
+        /**
+        @brief Media, genera out_of_range se la finestra è vuota
+        **/
+        double mean() const {
+            if(_count == 0)
+                throw std::out_of_range("Empty window");
+            return _mean;
+        }
+};
+
+/**
+@brief Estremo della finestra con una coda monotona
+
+Compare(a, b) è vero se a deve prevalere su b (std::less per il minimo).
+La coda contiene i candidati in ordine di arrivo e di valore: all'ingresso vengono scartati
+dal fondo quelli che il nuovo elemento supera, all'uscita il primo viene tolto se è l'elemento
+che lascia la finestra. Ogni elemento entra ed esce dalla coda una sola volta, quindi il costo
+è O(1) ammortizzato. La coda è un array circolare della stessa capacità della finestra
+**/
+template <typename T, typename Compare>
+class window_extreme {
+        std::vector<T> _queue; ///< Candidati, capacità uguale a quella della finestra
+        int _head; ///< Indice del primo candidato
+        int _count; ///< Numero di candidati
+        Compare _cmp;
+
+        int at(int i) const {
+            int pos = _head + i;
+            return pos < (int)_queue.size() ? pos : pos - (int)_queue.size();
+        }
+
+    public:
+        window_extreme(): _queue(), _head(0), _count(0), _cmp() {}
+
+        void reset(int capacity) {
+            _queue.assign(capacity > 0 ? capacity : 0, T());
+            _head = 0;
+            _count = 0;
+        }
+
+        void push(const T &value) {
+            while(_count > 0 && _cmp(value, _queue[at(_count - 1)]))
+                --_count;
+            _queue[at(_count)] = value;
+            ++_count;
+        }
+
+        void pop(const T &value) {
+            if(_count > 0 && !_cmp(value, _queue[_head]) && !_cmp(_queue[_head], value)){
+                _head = at(1);
+                --_count;
+            }
+        }
+
+        /**
+        @brief Estremo corrente, genera out_of_range se la finestra è vuota
+        **/
+        const T &value() const {
+            if(_count == 0)
+                throw std::out_of_range("Empty window");
+            return _queue[_head];
+        }
+};
+
+/**
+@brief Minimo della finestra, O(1) ammortizzato
+**/
+template <typename T>
+class window_min: public window_extreme<T, std::less<T> > {
+    public:
+        const T &min() const { return this->value(); }
+};
+
+/**
+@brief Massimo della finestra, O(1) ammortizzato
+**/
+template <typename T>
+class window_max: public window_extreme<T, std::greater<T> > {
+    public:
+        const T &max() const { return this->value(); }
+};
+
+/**
+@brief Buffer circolare con statistiche della finestra aggiornate a ogni inserimento
+
+Contiene un cbuffer<T> e un aggregatore per ogni tipo in Aggregators. Ogni elemento che
+entra viene passato a push di tutti gli aggregatori e ogni elemento che esce (rimozione
+o sovrascrittura del più vecchio a buffer pieno) a pop, prima di essere distrutto:
+le statistiche costano O(1) per elemento indipendentemente dalla capacità.
+Gli elementi sono accessibili solo in lettura, per non invalidare gli aggregati
+**/
+template <typename T, typename... Aggregators>
+class windowed_cbuffer {
+    public:
+        typedef T value_type; ///< Definzione del tipo corrispondente al valore contenuto del buffer
+        typedef typename cbuffer<T>::size_type size_type; ///< Definzione del tipo corrispondente a size
+        typedef typename cbuffer<T>::const_iterator const_iterator; ///< Iteratore in ordine logico
+    private:
+        cbuffer<T> _window; ///< Elementi della finestra
+        std::tuple<Aggregators...> _aggregators; ///< Aggregatori
+
+        void entered(const T &value){
+            std::apply([&value](Aggregators &...a){ (a.push(value), ...); }, _aggregators);
+        }
+
+        void leaving(const T &value){
+            std::apply([&value](Aggregators &...a){ (a.pop(value), ...); }, _aggregators);
+        }
+
+    public:
+        /**
+        @brief Costruttore con capacità
+
+        @param size Numero di elementi della finestra
+        **/
+        explicit windowed_cbuffer(size_type size): _window(size), _aggregators() {
+            std::apply([size](Aggregators &...a){ (a.reset(size), ...); }, _aggregators);
+        }
+
+        /**
+        @brief Inserimento di un elemento in coda
+
+        Se la finestra è piena il più vecchio esce dagli aggregatori e viene sovrascritto
+        @param value Valore da inserire
+        @return l'esito dell'inserimento nel cbuffer
+        **/
+        insert_result insert(const T &value){
+            if(_window.size() == 0)
+                return _window.insert(value);
+            if(_window.full())
+                leaving(_window[0]);
+            insert_result r = _window.insert(value);
+            entered(_window[count() - 1]);
+            return r;
+        }
+
+        /**
+        @brief Inserimento per spostamento di un elemento in coda
+        **/
+        insert_result insert(T &&value){
+            if(_window.size() == 0)
+                return _window.insert(std::move(value));
+            if(_window.full())
+                leaving(_window[0]);
+            insert_result r = _window.insert(std::move(value));
+            entered(_window[count() - 1]);
+            return r;
+        }
+
+        /**
+        @brief Costruzione di un elemento in coda
+        **/
+        template <typename... Args>
+        insert_result emplace(Args&&... args){
+            return insert(T(std::forward<Args>(args)...));
+        }
+
+        /**
+        @brief Inserimento in ordine degli elementi di [first, last)
+        **/
+        template <typename iteratorQ>
+        void insert(iteratorQ first, iteratorQ last){
+            for(; first != last; ++first)
+                insert(*first);
+        }
+
+        /**
+        @brief Rimozione dell'elemento più vecchio
+
+        @return true se un elemento è stato rimosso, false se la finestra era vuota
+        **/
+        bool remove(){
+            if(_window.empty())
+                return false;
+            leaving(_window[0]);
+            return _window.remove();
+        }
+
+        /**
+        @brief Estrazione dell'elemento più vecchio
+
+        Se la finestra è vuota genera un eccezione out_of_range
+        **/
+        T pop(){
+            if(_window.empty())
+                throw std::out_of_range("Pop from empty cbuffer");
+            leaving(_window[0]);
+            return _window.pop();
+        }
+
+        /**
+        @brief Svuota la finestra e azzera gli aggregatori
+        **/
+        void clear(){
+            _window.remove(count());
+            std::apply([this](Aggregators &...a){ (a.reset(_window.size()), ...); }, _aggregators);
+        }
+
+        /**
+        @brief Aggregatore di tipo A
+
+        Ad esempio cb.template aggregator<window_max<float> >().max()
+        **/
+        template <typename A>
+        const A &aggregator() const {
+            return std::get<A>(_aggregators);
+        }
+
+        /**
+        @brief Elementi della finestra come cbuffer in sola lettura
+        **/
+        const cbuffer<T> &window() const {
+            return _window;
+        }
+
+        const T &operator[](size_type index) const {
+            return _window[index];
+        }
+
+        bool empty() const {
+            return _window.empty();
+        }
+
+        bool full() const {
+            return _window.full();
+        }
+
+        /**
+        @brief Capacità della finestra
+        **/
+        size_type size() const {
+            return _window.size();
+        }
+
+        /**
+        @brief Numero di elementi presenti
+        **/
+        size_type count() const {
+            return static_cast<size_type>(_window.array_one().size() + _window.array_two().size());
+        }
+
+        const_iterator begin() const {
+            return _window.begin();
+        }
+
+        const_iterator end() const {
+            return _window.end();
+        }
+};
+
+/**
+@brief Operatore di stream
+
+Stesso formato di cbuffer
+**/
+template <typename T, typename... Aggregators>
+std::ostream &operator<<(std::ostream &os, const windowed_cbuffer<T, Aggregators...> &cb){
+    return os << cb.window();
+}
+
+#endif